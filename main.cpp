@@ -3,28 +3,118 @@
 #include <cmath>
 #include <map>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <array>
 #include <algorithm>
 #include <stdexcept>
 #include <set>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <complex>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <cfloat>
+#include <cstdio>
+#include <charconv>
+#include <filesystem>
+#include <chrono>
+#include <numeric>
+#include <unordered_map>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Функции с этой пометкой компилируются в нескольких вариантах (AVX-512, AVX2, базовый),
+// нужный выбирается при запуске по возможностям процессора
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__)
+#define MULTI_ISA __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define MULTI_ISA
+#endif
 
 const long double EPS = 1e-10;
 const int LenAlphabet = 26;
 const long double INF = 1e9;
 
+// Пороги плотного одномерного умножения (подбираются под машину):
+// до KaratsubaThreshold членов — школьное умножение, до FftThreshold — Карацуба, дальше — БПФ.
+// DenseFill — минимальная доля ненулевых коэффициентов, при которой многочлен считается плотным.
+int KaratsubaThreshold = 32;
+int FftThreshold = 1024;
+double DenseFill = 0.25;
+// Деление через обращение ряда Ньютоном, когда и частное, и делитель длиннее порога
+int NewtonDivThreshold = 256;
+
 #include <utility> // для std::pair
 
 // Шаблонная функция для создания пары
 template <typename T1, typename T2>
 std::pair<T1, T2> make_pair_custom(T1 first, T2 second) {
-  return std::pair<T1, T2>(first, second);
+  return std::pair<T1, T2>(std::move(first), std::move(second));
 }
 
 template<typename T>
 class List;
 
+// Пул узлов одного размера: освобождённые узлы идут на следующие выделения, а не в кучу.
+// У каждого потока свой список свободных, и узел можно освободить не в том потоке, где он
+// выделен. Поэтому блок нельзя отдать в кучу, пока живёт хоть один поток: пул намеренно
+// не освобождает блоки, и занятая им память равна пику числа узлов за время работы.
+template<size_t Size>
+class NodePool {
+  union Slot {
+    Slot *next;
+    alignas(std::max_align_t) char data[Size];
+  };
+
+  static const int BlockSlots = 1024;
+
+  static Slot *&Head() {
+    static thread_local Slot *head = nullptr;
+    return head;
+  }
+
+ public:
+  static void *Allocate() {
+    Slot *&head = Head();
+    if (head == nullptr) {
+      Slot *block = static_cast<Slot *>(::operator new(sizeof(Slot) * BlockSlots));
+      for (int i = 0; i < BlockSlots; i++) {
+        block[i].next = (i + 1 < BlockSlots ? &block[i + 1] : nullptr);
+      }
+      head = block;
+    }
+    Slot *res = head;
+    head = res->next;
+    return res;
+  }
+
+  static void Deallocate(void *ptr) {
+    Slot *slot = static_cast<Slot *>(ptr);
+    slot->next = Head();
+    Head() = slot;
+  }
+};
+
 template<typename T>
-class Node_List {
+class Node_List final {
   friend class List<T>;
   T data;
   Node_List<T> *next = nullptr;
@@ -37,11 +127,20 @@ class Node_List {
   friend List<T2> MergeSort(List<T2> now);
 
  public:
-  Node_List(T data, Node_List *prev, Node_List *next) : data(data), prev(prev), next(next) {
+  Node_List(T data, Node_List *prev, Node_List *next) : data(std::move(data)), prev(prev), next(next) {
   };
 
   Node_List() {
   };
+
+  // класс final, так что запрошенный размер всегда sizeof(Node_List)
+  static void *operator new(size_t) {
+    return NodePool<sizeof(Node_List)>::Allocate();
+  }
+
+  static void operator delete(void *ptr) {
+    NodePool<sizeof(Node_List)>::Deallocate(ptr);
+  }
 };
 
 template<typename T>
@@ -62,7 +161,6 @@ class List {
   ~List();
 
   List(const List<T> &now) {
-    Clear();
     int ind = 0;
     Node_List<T> *cur = now.begin;
 
@@ -73,6 +171,12 @@ class List {
     }
   }
 
+  List(List<T> &&now) noexcept {
+    std::swap(begin, now.begin);
+    std::swap(end, now.end);
+    std::swap(size, now.size);
+  }
+
   void Clear();
 
   void PushBack(T x);
@@ -99,10 +203,10 @@ template<typename T>
 void List<T>::PushBack(T val) {
   size++;
   if (begin == nullptr) {
-    begin = new Node_List<T>(val, nullptr, nullptr);
+    begin = new Node_List<T>(std::move(val), nullptr, nullptr);
     end = begin;
   } else {
-    Node_List<T> *now = new Node_List<T>(val, nullptr, nullptr);
+    Node_List<T> *now = new Node_List<T>(std::move(val), nullptr, nullptr);
     end->next = now;
     now->prev = end;
     end = now;
@@ -131,19 +235,17 @@ void List<T>::Erase(int pos) {
     now = now->next;
     my_index++;
   }
-  if (now->prev == nullptr and now->next == nullptr) {
-    begin = nullptr;
-    end = nullptr;
-    delete now;
-  } else if (now->prev == nullptr) {
+  if (now->prev == nullptr) {
     begin = now->next;
-  } else if (now->next == nullptr) {
-    end = now->prev;
   } else {
     now->prev->next = now->next;
+  }
+  if (now->next == nullptr) {
+    end = now->prev;
+  } else {
     now->next->prev = now->prev;
-    delete now;
   }
+  delete now;
   size--;
 }
 
@@ -177,6 +279,8 @@ void List<T>::Clear() {
     size--;
     delete cnt;
   }
+  begin = nullptr;
+  end = nullptr;
 }
 
 template<typename T>
@@ -189,35 +293,30 @@ T &List<T>::back() const {
   return end->data;
 }
 
+// Merge и MergeSort забирают узлы аргументов и перецепляют их, ничего не копируя и не выделяя;
+// чтобы сохранить исходный список, передавайте копию, иначе — std::move
 template<typename T>
 List<T> Merge(List<T> first, List<T> second) {
-  Node_List<T> *left = first.begin;
-  int size1 = 0;
-  Node_List<T> *right = second.begin;
-  int size2 = 0;
-
   List<T> res;
-
-  while (size1 < first.size and size2 < second.size) {
-    if (left->data < right->data) {
-      res.PushBack(left->data);
-      left = left->next;
-      size1++;
+  while (first.size > 0 or second.size > 0) {
+    List<T> &from = (second.size == 0 or (first.size > 0 and first.begin->data < second.begin->data)) ? first : second;
+    Node_List<T> *element = from.begin;
+    from.begin = element->next;
+    if (from.begin != nullptr) {
+      from.begin->prev = nullptr;
     } else {
-      res.PushBack(right->data);
-      right = right->next;
-      size2++;
+      from.end = nullptr;
     }
-  }
-  while (size1 < first.size) {
-    res.PushBack(left->data);
-    size1++;
-    left = left->next;
-  }
-  while (size2 < second.size) {
-    res.PushBack(right->data);
-    size2++;
-    right = right->next;
+    from.size--;
+    element->next = nullptr;
+    element->prev = res.end;
+    if (res.end != nullptr) {
+      res.end->next = element;
+    } else {
+      res.begin = element;
+    }
+    res.end = element;
+    res.size++;
   }
   return res;
 }
@@ -227,602 +326,6073 @@ List<T> MergeSort(List<T> now) {
   if (now.size <= 1) {
     return now;
   }
-  List<T> first;
+  Node_List<T> *middle = now.begin;
+  for (int my_index = 1; my_index < now.size / 2; my_index++) {
+    middle = middle->next;
+  }
   List<T> second;
-  Node_List<T> *element = now.begin;
-  int my_index = 0;
-  while (my_index < now.size / 2) {
-    first.PushBack(element->data);
-    my_index++;
-    element = element->next;
+  second.begin = middle->next;
+  second.end = now.end;
+  second.size = now.size - now.size / 2;
+  second.begin->prev = nullptr;
+  middle->next = nullptr;
+  now.end = middle;
+  now.size /= 2;
+  return Merge(MergeSort(std::move(now)), MergeSort(std::move(second)));
+}
+
+// Пул рабочих потоков. ParallelFor делит диапазон на куски, которые разбирают
+// и рабочие потоки, и сам вызывающий, поэтому его можно звать и изнутри задачи пула.
+class ThreadPool {
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()> > tasks;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stop = false;
+
+  void Loop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return stop or !tasks.empty(); });
+        if (stop and tasks.empty()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
   }
-  while (my_index < now.size) {
-    second.PushBack(element->data);
-    my_index++;
-    element = element->next;
+
+ public:
+  explicit ThreadPool(int threads) {
+    for (int i = 0; i < std::max(threads, 1); i++) {
+      workers.emplace_back([this] { Loop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    for (auto &w: workers) {
+      w.join();
+    }
+  }
+
+  int GetSize() const {
+    return (int) workers.size();
+  }
+
+  template<typename F>
+  auto Submit(F f) -> std::future<decltype(f())> {
+    auto task = std::make_shared<std::packaged_task<decltype(f())()> >(std::move(f));
+    auto res = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace_back([task] { (*task)(); });
+    }
+    cv.notify_one();
+    return res;
+  }
+
+  // body(begin, end) вызывается для кусков [0, n) длиной не больше grain.
+  // Первое исключение из body пробрасывается вызывающему, когда все начатые куски закончатся;
+  // ещё не начатые куски после него пропускаются.
+  void ParallelFor(long long n, long long grain, const std::function<void(long long, long long)> &body) {
+    long long chunks = (n + grain - 1) / grain;
+    if (chunks <= 1) {
+      if (n > 0) {
+        body(0, n);
+      }
+      return;
+    }
+    struct State {
+      std::atomic<long long> next{0};
+      std::atomic<long long> done{0};
+      std::atomic<bool> failed{false};
+      std::exception_ptr error;
+      std::mutex mutex;
+      std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    auto run = [state, chunks, grain, n, &body] {
+      long long c;
+      while ((c = state->next.fetch_add(1)) < chunks) {
+        if (!state->failed.load()) {
+          try {
+            body(c * grain, std::min(n, (c + 1) * grain));
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (!state->error) {
+              state->error = std::current_exception();
+            }
+            state->failed = true;
+          }
+        }
+        if (state->done.fetch_add(1) + 1 == chunks) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          state->cv.notify_all();
+        }
+      }
+    };
+    long long helpers = std::min<long long>(chunks - 1, GetSize());
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (long long i = 0; i < helpers; i++) {
+        tasks.emplace_back(run);
+      }
+    }
+    cv.notify_all();
+    run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->done.load() == chunks; });
+    if (state->error) {
+      std::rethrow_exception(state->error);
+    }
   }
-  first = MergeSort(first);
-  second = MergeSort(second);
-  return Merge(first, second);
+};
+
+// Общий пул на все ядра машины
+ThreadPool &DefaultPool() {
+  static ThreadPool pool((int) std::thread::hardware_concurrency());
+  return pool;
 }
 
-class Monomial {
- private:
-  friend class Polynomial;
+// Состояние фоновой задачи, общее для UI и вычисления
+struct JobState {
+  // доля сделанного; -1 — неизвестна
+  std::atomic<float> progress{-1};
+  std::atomic<bool> cancelled{false};
+};
 
-  template<typename T1>
-  friend List<T1> Merge(List<T1> first, List<T1> second);
+// Бросается из точки проверки, когда задачу отменили
+struct JobCancelled {
+};
 
-  template<typename T2>
-  friend List<T2> MergeSort(List<T2> now);
+// Задача, которую выполняет текущий поток (nullptr вне задач)
+thread_local JobState *CurrentJob = nullptr;
 
-  long double cf;
-  std::vector<int> deg;
+// Точка проверки в долгих циклах: отмечает долю сделанного (done < 0 — неизвестна)
+// и прерывает отменённую задачу. Потоки пула внутри ParallelFor задачи не видят,
+// поэтому проверки стоят только в последовательных частях.
+void JobCheckpoint(double done = -1) {
+  JobState *job = CurrentJob;
+  if (job == nullptr) {
+    return;
+  }
+  if (done >= 0) {
+    job->progress.store((float) done, std::memory_order_relaxed);
+  }
+  if (job->cancelled.load(std::memory_order_relaxed)) {
+    throw JobCancelled();
+  }
+}
+
+// Запущенная задача: будущий результат плюс прогресс и отмена
+template<typename T>
+class Job {
+  std::shared_ptr<JobState> state;
+  std::future<T> result;
 
  public:
-  Monomial() {
-    deg.resize(LenAlphabet, 0);
+  Job(std::shared_ptr<JobState> state, std::future<T> result) : state(std::move(state)), result(std::move(result)) {
   }
 
-  Monomial(long double cf, std::vector<int> deg) : cf(cf),
-                                                   deg(deg) {
-  };
+  bool Ready() const {
+    return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
 
-  long double GetY(std::vector<long double> variables) const;
+  float Progress() const {
+    return state->progress.load(std::memory_order_relaxed);
+  }
 
-  std::vector<int> Deg() const;
+  void Cancel() {
+    state->cancelled = true;
+  }
 
-  bool operator <(Monomial second) const {
-    return deg < second.deg;
+  // Бросает JobCancelled для отменённой задачи и исключения самой задачи
+  T Get() {
+    return result.get();
   }
 };
 
-struct Comp {
-  bool operator()(const Monomial &a,
-                  const Monomial &b) const {
-    return a.Deg() < b.Deg();
+// Монотонная арена для временной памяти ядер: выделение — сдвиг указателя, отдельные
+// освобождения ничего не делают, Reset отдаёт всё разом. После Reset остаётся один блок
+// размером со всё, что понадобилось, так что повторные операции в куче уже не выделяют.
+// Сверх limit байт арена не растёт: дальше выделения идут в обычную кучу и освобождаются сразу,
+// так что долгая цепочка операций без Reset не копит память.
+// Не потокобезопасна: одна арена — один поток.
+class Arena : public std::pmr::memory_resource {
+  std::vector<std::unique_ptr<char[]> > blocks;
+  std::vector<size_t> sizes;
+  size_t total = 0;
+  size_t limit;
+  char *cur = nullptr;
+  size_t left = 0;
+
+  bool Grow(size_t need) {
+    size_t size = std::max(need, std::max<size_t>(total, 1 << 16));
+    if (total + size > limit) {
+      return false;
+    }
+    blocks.emplace_back(new char[size]);
+    sizes.push_back(size);
+    total += size;
+    cur = blocks.back().get();
+    left = size;
+    return true;
+  }
+
+  bool Owns(const void *p) const {
+    for (size_t i = 0; i < blocks.size(); i++) {
+      const char *begin = blocks[i].get();
+      if (std::less_equal<const void *>()(begin, p) and std::less<const void *>()(p, begin + sizes[i])) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ protected:
+  void *do_allocate(size_t bytes, size_t align) override {
+    size_t pad = -(uintptr_t) cur & (align - 1);
+    if (cur == nullptr or pad + bytes > left) {
+      if (!Grow(bytes + align)) {
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+      }
+      pad = -(uintptr_t) cur & (align - 1);
+    }
+    void *res = cur + pad;
+    cur += pad + bytes;
+    left -= pad + bytes;
+    return res;
+  }
+
+  void do_deallocate(void *p, size_t bytes, size_t align) override {
+    if (!Owns(p)) {
+      std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+ public:
+  explicit Arena(size_t limit = SIZE_MAX) : limit(limit) {
+  }
+
+  Arena(const Arena &) = delete;
+
+  Arena &operator =(const Arena &) = delete;
+
+  // Всё выделенное становится недействительным
+  void Reset() {
+    if (blocks.size() > 1) {
+      blocks.clear();
+      blocks.emplace_back(new char[total]);
+      sizes.assign(1, total);
+    }
+    cur = blocks.empty() ? nullptr : blocks.back().get();
+    left = blocks.empty() ? 0 : total;
+  }
+
+  size_t Capacity() const {
+    return total;
   }
 };
 
-class Polynomial {
- private:
-  List<Monomial> monos;
+// Предел арены одного потока JobExecutor
+const size_t JobArenaLimit = (size_t) 256 << 20;
 
-  void Normalize();
+// Арена для временной памяти ядер в текущем потоке (nullptr — обычная куча)
+thread_local std::pmr::memory_resource *CurrentScratch = nullptr;
 
-  bool CheckCntVars() const;
+// Память, из которой ядра по умолчанию берут рабочие массивы
+std::pmr::memory_resource *Scratch() {
+  return CurrentScratch != nullptr ? CurrentScratch : std::pmr::get_default_resource();
+}
+
+// На время жизни объекта операции многочленов в этом потоке берут рабочую память из arena.
+// Результаты по-прежнему живут в куче, поэтому arena.Reset() между операциями безопасен.
+class ScratchScope {
+  std::pmr::memory_resource *prev;
 
  public:
-  Polynomial() = default;
+  explicit ScratchScope(std::pmr::memory_resource &arena) : prev(CurrentScratch) {
+    CurrentScratch = &arena;
+  }
 
-  Polynomial(List<Monomial> a) : monos(a) {
-  };
+  ScratchScope(const ScratchScope &) = delete;
 
-  Polynomial(std::string s);
+  ScratchScope &operator =(const ScratchScope &) = delete;
 
-  long double GetY(
-      std::vector<long double> variables) const;
+  ~ScratchScope() {
+    CurrentScratch = prev;
+  }
+};
 
-  bool operator ==(Polynomial second);
+// Исполнитель долгих операций на своих потоках, чтобы не занимать общий пул вычислений
+class JobExecutor {
+  ThreadPool pool;
 
-  Polynomial operator +(Polynomial second) const;
+ public:
+  explicit JobExecutor(int threads) : pool(threads) {
+  }
 
-  Polynomial operator -(Polynomial second) const;
+  template<typename F>
+  auto Run(F f) -> Job<decltype(f())> {
+    auto state = std::make_shared<JobState>();
+    auto res = pool.Submit([state, f]() mutable {
+      // временная память ядер — из арены потока исполнителя, она сбрасывается после каждой задачи
+      thread_local Arena arena(JobArenaLimit);
+      struct Reset {
+        Arena &arena;
 
-  std::pair<bool,
-            std::vector<int> > FindIntegerRoots() const;
+        ~Reset() {
+          CurrentJob = nullptr;
+          arena.Reset();
+        }
+      } reset{arena};
+      ScratchScope scope(arena);
+      CurrentJob = state.get();
+      JobCheckpoint();
+      return f();
+    });
+    return Job<decltype(f())>(state, std::move(res));
+  }
+};
 
-  Polynomial operator *(Polynomial second) const;
+// Упакованные степени одного члена: по 16 бит на переменную, 64 байта на ключ.
+// Лишние дорожки (LenAlphabet..31) всегда нулевые, поэтому сравнение, сложение
+// и проверка делимости идут по всему ключу четырьмя 128-битными операциями.
+struct alignas(16) ExpKey {
+  static const int Lanes = 32;
+  static const int MaxDeg = 0xFFFF;
 
-  std::pair<Polynomial, Polynomial> operator /(Polynomial second);
+  uint16_t e[Lanes];
 
+  ExpKey() {
+    std::memset(e, 0, sizeof(e));
+  }
 
-  std::string GetString() const;
+  uint16_t operator [](int ind) const {
+    return e[ind];
+  }
 
-  Polynomial derivative(int pos);
+  uint16_t &operator [](int ind) {
+    return e[ind];
+  }
 
-  int GetMask() const;
+  // Присваивание степени с проверкой на переполнение 16-битной дорожки
+  void Set(int ind, long long val) {
+    if (val < 0 or val > MaxDeg) {
+      throw std::overflow_error("Degree " + std::to_string(val) + " is out of range");
+    }
+    e[ind] = (uint16_t) val;
+  }
 
-  bool IsEmpty() const;
+  bool operator ==(const ExpKey &other) const;
+
+  bool operator !=(const ExpKey &other) const {
+    return !(*this == other);
+  }
+
+  // Лексикографический порядок: степень a старше степени b и т.д.
+  bool operator <(const ExpKey &other) const;
+
+  // Умножение мономов; бросает std::overflow_error, если степень не влезла в дорожку
+  ExpKey operator +(const ExpKey &other) const;
+
+  // Деление мономов, вызывать только если other.Divides(*this)
+  ExpKey operator -(const ExpKey &other) const;
+
+  // Делит ли этот моном моном other
+  bool Divides(const ExpKey &other) const;
+
+  // Наименьшее общее кратное мономов: покомпонентный максимум степеней
+  ExpKey Lcm(const ExpKey &other) const;
+
+  // Маска переменных с ненулевой степенью
+  int Mask() const;
+
+  long long TotalDegree() const;
+
+  uint64_t Hash() const {
+    uint64_t w[Lanes / 4];
+    std::memcpy(w, e, sizeof(w));
+    uint64_t h = 0;
+    for (int k = 0; k < (LenAlphabet + 3) / 4; k++) {
+      h = (h ^ w[k]) * 0x9E3779B97F4A7C15ULL;
+      h ^= h >> 29;
+    }
+    return h;
+  }
 };
 
-void DeletrSpace(std::string &s) {
-  std::string cnt;
-  for (auto i: s) {
-    if (i != ' ') cnt += i;
+#if defined(__SSE2__)
+
+inline bool ExpKey::operator ==(const ExpKey &other) const {
+  __m128i acc = _mm_setzero_si128();
+  for (int k = 0; k < Lanes; k += 8) {
+    __m128i a = _mm_load_si128((const __m128i *) (e + k));
+    __m128i b = _mm_load_si128((const __m128i *) (other.e + k));
+    acc = _mm_or_si128(acc, _mm_xor_si128(a, b));
   }
-  s = cnt;
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) == 0xFFFF;
 }
 
-void PopFront(std::string &s) {
-  std::reverse(s.begin(), s.end());
-  s.pop_back();
-  std::reverse(s.begin(), s.end());
+inline bool ExpKey::operator <(const ExpKey &other) const {
+  for (int k = 0; k < Lanes; k += 8) {
+    __m128i a = _mm_load_si128((const __m128i *) (e + k));
+    __m128i b = _mm_load_si128((const __m128i *) (other.e + k));
+    int eq = _mm_movemask_epi8(_mm_cmpeq_epi16(a, b));
+    if (eq != 0xFFFF) {
+      int lane = k + __builtin_ctz(~eq) / 2;
+      return e[lane] < other.e[lane];
+    }
+  }
+  return false;
 }
 
-Polynomial::Polynomial(std::string s) {
-  DeletrSpace(s);
-  std::string now;
-  bool sign = false;
-  std::map<Monomial, long double, Comp> mp;
+inline ExpKey ExpKey::operator +(const ExpKey &other) const {
+  ExpKey res;
+  __m128i bad = _mm_setzero_si128();
+  for (int k = 0; k < Lanes; k += 8) {
+    __m128i a = _mm_load_si128((const __m128i *) (e + k));
+    __m128i b = _mm_load_si128((const __m128i *) (other.e + k));
+    __m128i sum = _mm_add_epi16(a, b);
+    // насыщающее сложение расходится с обычным ровно там, где было переполнение
+    bad = _mm_or_si128(bad, _mm_xor_si128(sum, _mm_adds_epu16(a, b)));
+    _mm_store_si128((__m128i *) (res.e + k), sum);
+  }
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xFFFF) {
+    throw std::overflow_error("Degree is out of range");
+  }
+  return res;
+}
 
-  for (int i = 0; i < s.size(); i++) {
-    if (((s[i] == '-' or s[i] == '+') and (i != 0)) or (i == s.size() - 1)) {
-      if (i == s.size() - 1) {
-        now += s[i];
-      }
-      if (now.front() == '-') {
-        sign = true;
-      }
-      if (now.front() == '-' or now.front() == '+') {
-        PopFront(now);
-      }
-      Monomial all;
-      int pow_ten = 0;
-      bool dot = false;
-      all.cf = 0;
-      int start = now.size();
-      bool is_cf_one = false;
-      for (int j = 0; j < now.size(); j++) {
-        if (now[j] >= '0' and now[j] <= '9') {
-          is_cf_one = true;
+inline ExpKey ExpKey::operator -(const ExpKey &other) const {
+  ExpKey res;
+  for (int k = 0; k < Lanes; k += 8) {
+    __m128i a = _mm_load_si128((const __m128i *) (e + k));
+    __m128i b = _mm_load_si128((const __m128i *) (other.e + k));
+    _mm_store_si128((__m128i *) (res.e + k), _mm_sub_epi16(a, b));
+  }
+  return res;
+}
 
-          if (dot) {
-            all.cf += (long double) (now[j] - '0') * pow(10, pow_ten);
-            pow_ten--;
-          } else {
-            all.cf *= 10LL;
-            all.cf += (now[j] - '0');
-          }
-        } else if (now[j] == '.') {
-          dot = true;
-          pow_ten = -1;
-        } else {
-          start = j;
-          break;
-        }
-      }
-      if (all.cf == 0 and !is_cf_one) {
-        all.cf = 1;
-      }
-      if (sign) {
-        all.cf *= (long double) -1;
-      }
-      sign = false;
+inline bool ExpKey::Divides(const ExpKey &other) const {
+  __m128i acc = _mm_setzero_si128();
+  for (int k = 0; k < Lanes; k += 8) {
+    __m128i a = _mm_load_si128((const __m128i *) (e + k));
+    __m128i b = _mm_load_si128((const __m128i *) (other.e + k));
+    acc = _mm_or_si128(acc, _mm_subs_epu16(a, b));
+  }
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) == 0xFFFF;
+}
 
-      int cur_pow = INF;
-      for (int j = start; j < now.size(); j++) {
-        int ind = j;
-        if (j + 1 >= now.size() or now[j + 1] != '^') {
-          cur_pow = 1;
-        } else {
-          cur_pow = 0;
-          for (int id = j + 2; id < now.size() and now[id] >= '0' and now[id] <= '9'; id++) {
-            cur_pow *= 10;
-            cur_pow += now[id] - '0';
-            j = id;
-          }
-        }
-        all.deg[now[ind] - 'a'] += cur_pow;
-      }
-      if (mp.find(all) == mp.end()) {
-        if (all.cf != 0) {
-          mp[all] = monos.GetSize();
-          monos.PushBack(all);
-        }
-      } else {
-        monos[mp[all]].cf += all.cf;
+inline ExpKey ExpKey::Lcm(const ExpKey &other) const {
+  ExpKey res;
+  for (int k = 0; k < Lanes; k += 8) {
+    __m128i a = _mm_load_si128((const __m128i *) (e + k));
+    __m128i b = _mm_load_si128((const __m128i *) (other.e + k));
+    // max(a, b) = a + (b - a с насыщением); в SSE2 нет беззнакового max для 16 бит
+    _mm_store_si128((__m128i *) (res.e + k), _mm_add_epi16(a, _mm_subs_epu16(b, a)));
+  }
+  return res;
+}
+
+inline int ExpKey::Mask() const {
+  __m128i zero = _mm_setzero_si128();
+  int res = 0;
+  for (int k = 0; k < Lanes; k += 16) {
+    __m128i a = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *) (e + k)), zero);
+    __m128i b = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *) (e + k + 8)), zero);
+    res |= (_mm_movemask_epi8(_mm_packs_epi16(a, b)) ^ 0xFFFF) << k;
+  }
+  return res;
+}
+
+#else
+
+inline bool ExpKey::operator ==(const ExpKey &other) const {
+  return std::memcmp(e, other.e, sizeof(e)) == 0;
+}
+
+inline bool ExpKey::operator <(const ExpKey &other) const {
+  return std::lexicographical_compare(e, e + Lanes, other.e, other.e + Lanes);
+}
+
+inline ExpKey ExpKey::operator +(const ExpKey &other) const {
+  ExpKey res;
+  for (int k = 0; k < Lanes; k++) {
+    res.Set(k, (long long) e[k] + other.e[k]);
+  }
+  return res;
+}
+
+inline ExpKey ExpKey::operator -(const ExpKey &other) const {
+  ExpKey res;
+  for (int k = 0; k < Lanes; k++) {
+    res.e[k] = e[k] - other.e[k];
+  }
+  return res;
+}
+
+inline bool ExpKey::Divides(const ExpKey &other) const {
+  for (int k = 0; k < Lanes; k++) {
+    if (e[k] > other.e[k]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline ExpKey ExpKey::Lcm(const ExpKey &other) const {
+  ExpKey res;
+  for (int k = 0; k < Lanes; k++) {
+    res.e[k] = std::max(e[k], other.e[k]);
+  }
+  return res;
+}
+
+inline int ExpKey::Mask() const {
+  int res = 0;
+  for (int k = 0; k < LenAlphabet; k++) {
+    if (e[k] != 0) {
+      res |= (1 << k);
+    }
+  }
+  return res;
+}
+
+#endif
+
+inline long long ExpKey::TotalDegree() const {
+  long long res = 0;
+  for (int k = 0; k < LenAlphabet; k++) {
+    res += e[k];
+  }
+  return res;
+}
+
+// Мономиальные порядки: лексикографический (a старше b старше ...), по полной степени
+// с лексикографическим внутри (grlex) и по полной степени с обратным лексикографическим (grevlex).
+// Члены многочлена хранятся по возрастанию в его порядке, старший член — последний.
+enum class MonomialOrder {
+  Lex,
+  GrLex,
+  GrevLex
+};
+
+// Строгое «меньше» для ключей в заданном порядке
+struct OrderLess {
+  MonomialOrder order = MonomialOrder::Lex;
+
+  bool operator ()(const ExpKey &a, const ExpKey &b) const {
+    if (order == MonomialOrder::Lex) {
+      return a < b;
+    }
+    long long ta = a.TotalDegree(), tb = b.TotalDegree();
+    if (ta != tb) {
+      return ta < tb;
+    }
+    if (order == MonomialOrder::GrLex) {
+      return a < b;
+    }
+    // при равной степени младше тот, у кого больше степень последней различающейся переменной
+    for (int k = LenAlphabet - 1; k >= 0; k--) {
+      if (a[k] != b[k]) {
+        return a[k] > b[k];
       }
-      now.clear();
     }
-    now += s[i];
+    return false;
+  }
+};
+
+// Перестановка, упорядочивающая degs[0..n) по возрастанию в order (равные ключи — в исходном порядке).
+// LSD-сортировка подсчётом по байтам ключа: младшие разряды — младшие переменные
+// (у grevlex — наоборот и с обратным знаком), старшие — полная степень у градуированных порядков.
+// Проходы идут только по встречающимся переменным, проход, где все байты равны, пропускается.
+std::pmr::vector<int> RadixOrder(const ExpKey *degs, int n, MonomialOrder order,
+                                 std::pmr::memory_resource *mem = Scratch()) {
+  std::pmr::vector<int> perm(n, mem);
+  for (int i = 0; i < n; i++) {
+    perm[i] = i;
+  }
+  if (n < 64) {
+    // устойчивость — через номер при равных ключах, stable_sort выделял бы буфер
+    OrderLess less{order};
+    std::sort(perm.begin(), perm.end(), [&](int a, int b) {
+      return less(degs[a], degs[b]) or (!less(degs[b], degs[a]) and a < b);
+    });
+    return perm;
+  }
+  int mask = 0;
+  for (int i = 0; i < n; i++) {
+    mask |= degs[i].Mask();
+  }
+  bool graded = order != MonomialOrder::Lex;
+  std::pmr::vector<uint32_t> total(graded ? n : 0, mem);
+  for (int i = 0; i < (int) total.size(); i++) {
+    total[i] = (uint32_t) degs[i].TotalDegree();
+  }
+  // разряды от младшего к старшему: lane < 0 — полная степень
+  struct Digit {
+    int lane;
+    int shift;
+    bool flip;
+  };
+  Digit digits[2 * LenAlphabet + 3];
+  int digit_count = 0;
+  for (int k = 0; k < LenAlphabet; k++) {
+    int lane = order == MonomialOrder::GrevLex ? k : LenAlphabet - 1 - k;
+    if (mask >> lane & 1) {
+      digits[digit_count++] = Digit{lane, 0, order == MonomialOrder::GrevLex};
+      digits[digit_count++] = Digit{lane, 8, order == MonomialOrder::GrevLex};
+    }
+  }
+  if (graded) {
+    for (int shift = 0; shift < 24; shift += 8) {
+      digits[digit_count++] = Digit{-1, shift, false};
+    }
+  }
+  std::pmr::vector<int> next(n, mem);
+  // байты разряда выписываются подряд, чтобы при раскладке не ходить по 64-байтным ключам вразнобой
+  std::pmr::vector<uint8_t> bytes(n, mem);
+  for (int p = 0; p < digit_count; p++) {
+    const Digit &d = digits[p];
+    int count[257] = {};
+    for (int i = 0; i < n; i++) {
+      unsigned v = d.lane < 0 ? total[i] : (d.flip ? 0xFFFFu - degs[i][d.lane] : degs[i][d.lane]);
+      bytes[i] = (uint8_t) (v >> d.shift);
+      count[bytes[i] + 1]++;
+    }
+    if (count[bytes[0] + 1] == n) {
+      continue;
+    }
+    for (int b = 0; b < 256; b++) {
+      count[b + 1] += count[b];
+    }
+    for (int i = 0; i < n; i++) {
+      next[count[bytes[perm[i]]]++] = perm[i];
+    }
+    perm.swap(next);
+  }
+  return perm;
+}
+
+class Monomial {
+ private:
+  friend class Polynomial;
+  template<typename R>
+  friend class BasicTermStore;
+
+  template<typename T1>
+  friend List<T1> Merge(List<T1> first, List<T1> second);
+
+  template<typename T2>
+  friend List<T2> MergeSort(List<T2> now);
+
+  long double cf;
+  ExpKey deg;
+
+ public:
+  Monomial() = default;
+
+  Monomial(long double cf, const ExpKey &deg) : cf(cf),
+                                                deg(deg) {
+  };
+
+  long double GetY(std::vector<long double> variables) const;
+
+  const ExpKey &Deg() const;
+
+  bool operator <(const Monomial &second) const {
+    return deg < second.deg;
+  }
+};
+
+struct Comp {
+  bool operator()(const Monomial &a,
+                  const Monomial &b) const {
+    return a.Deg() < b.Deg();
+  }
+};
+
+// Свойства кольца коэффициентов для шаблонных ядер. IsZero решает, выбрасывать ли член;
+// у вещественных коэффициентов это сравнение с EPS, у точных колец — точное.
+// Полные описания колец (перевод из long double и обратно, запись числа) — рядом с BasicPolynomial.
+template<typename R>
+struct Ring;
+
+template<>
+struct Ring<long double> {
+  static bool IsZero(long double x) {
+    return std::abs(x) <= EPS;
+  }
+
+  static long double FromLongDouble(long double x) {
+    return x;
+  }
+
+  static long double ToLongDouble(long double x) {
+    return x;
+  }
+
+  static void Format(std::string &out, long double x);
+};
+
+template<>
+struct Ring<double> {
+  static bool IsZero(double x) {
+    return std::abs(x) <= EPS;
+  }
+
+  static double FromLongDouble(long double x) {
+    return (double) x;
+  }
+
+  static long double ToLongDouble(double x) {
+    return x;
+  }
+
+  static void Format(std::string &out, double x);
+};
+
+// Хранилище членов многочлена в виде структуры массивов:
+// коэффициенты и упакованные степени лежат в двух непрерывных массивах.
+template<typename R>
+class BasicTermStore {
+  std::vector<R> cfs;
+  std::vector<ExpKey> degs;
+
+ public:
+  struct Term {
+    R &cf;
+    ExpKey &deg;
+  };
+
+  struct ConstTerm {
+    const R &cf;
+    const ExpKey &deg;
+  };
+
+  template<bool IsConst>
+  class Iterator {
+    using Store = typename std::conditional<IsConst, const BasicTermStore, BasicTermStore>::type;
+    using Ref = typename std::conditional<IsConst, ConstTerm, Term>::type;
+    Store *store;
+    int ind;
+
+   public:
+    Iterator(Store *store, int ind) : store(store), ind(ind) {
+    };
+
+    Ref operator *() const {
+      return Ref{store->cfs[ind], store->Deg(ind)};
+    }
+
+    Iterator &operator ++() {
+      ind++;
+      return *this;
+    }
+
+    bool operator !=(const Iterator &other) const {
+      return ind != other.ind;
+    }
+
+    bool operator ==(const Iterator &other) const {
+      return ind == other.ind;
+    }
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  int GetSize() const {
+    return (int) cfs.size();
+  }
+
+  bool Empty() const {
+    return cfs.empty();
+  }
+
+  void Reserve(int n) {
+    cfs.reserve(n);
+    degs.reserve(n);
+  }
+
+  void ShrinkToFit() {
+    cfs.shrink_to_fit();
+    degs.shrink_to_fit();
+  }
+
+  void Clear() {
+    cfs.clear();
+    degs.clear();
+  }
+
+  void PopBack() {
+    cfs.pop_back();
+    degs.pop_back();
+  }
+
+  void PushBack(const R &cf, const ExpKey &deg) {
+    cfs.push_back(cf);
+    degs.push_back(deg);
+  }
+
+  void PushBack(const Monomial &x) {
+    PushBack(x.cf, x.deg);
+  }
+
+  // Дописывает все члены other одним куском
+  void Append(const BasicTermStore &other) {
+    cfs.insert(cfs.end(), other.cfs.begin(), other.cfs.end());
+    degs.insert(degs.end(), other.degs.begin(), other.degs.end());
+  }
+
+  // Упорядочивает члены по order, складывает подобные и выбрасывает нулевые (см. Ring::IsZero):
+  // RadixOrder и один линейный проход, результат остаётся в этом же буфере
+  void Normalize(MonomialOrder order = MonomialOrder::Lex, std::pmr::memory_resource *mem = Scratch()) {
+    std::pmr::vector<int> perm = RadixOrder(degs.data(), GetSize(), order, mem);
+    std::pmr::vector<R> old_cfs(std::make_move_iterator(cfs.begin()), std::make_move_iterator(cfs.end()), mem);
+    std::pmr::vector<ExpKey> old_degs(degs.begin(), degs.end(), mem);
+    int out = 0;
+    for (int i: perm) {
+      if (out > 0 and degs[out - 1] == old_degs[i]) {
+        cfs[out - 1] += old_cfs[i];
+        continue;
+      }
+      if (out > 0 and Ring<R>::IsZero(cfs[out - 1])) {
+        out--;
+      }
+      cfs[out] = std::move(old_cfs[i]);
+      degs[out] = old_degs[i];
+      out++;
+    }
+    if (out > 0 and Ring<R>::IsZero(cfs[out - 1])) {
+      out--;
+    }
+    cfs.resize(out);
+    degs.resize(out);
+  }
+
+  // Прибавляет other (или вычитает при negate); оба упорядочены по order и без повторов.
+  // Слияние идёт с конца прямо в этот буфер, так что памяти не выделяется, если хватает ёмкости.
+  void MergeSorted(const BasicTermStore &other, bool negate, MonomialOrder order = MonomialOrder::Lex) {
+    if (&other == this) {
+      MergeSorted(BasicTermStore(other), negate, order);
+      return;
+    }
+    MergeWith(other.GetSize(), [&](int j) {
+      return negate ? -other.cfs[j] : other.cfs[j];
+    }, [&](int j) {
+      return other.degs[j];
+    }, OrderLess{order});
+  }
+
+  // Прибавляет other * factor * x^shift; умножение на одночлен порядок членов не меняет.
+  // При count >= 0 берутся только count младших членов other (например, всё, кроме старшего).
+  void MergeScaled(const BasicTermStore &other, const R &factor, const ExpKey &shift,
+                   MonomialOrder order = MonomialOrder::Lex, int count = -1) {
+    if (&other == this) {
+      MergeScaled(BasicTermStore(other), factor, shift, order, count);
+      return;
+    }
+    MergeWith(count < 0 ? other.GetSize() : count, [&](int j) {
+      return other.cfs[j] * factor;
+    }, [&](int j) {
+      return other.degs[j] + shift;
+    }, OrderLess{order});
+  }
+
+ private:
+  // Слияние с m членами, заданными через cf_of(j) и deg_of(j); они не должны читать *this
+  template<typename CfOf, typename DegOf>
+  void MergeWith(int m, CfOf cf_of, DegOf deg_of, OrderLess less) {
+    int n = GetSize();
+    cfs.resize(n + m);
+    degs.resize(n + m);
+    int i = n - 1, j = m - 1, w = n + m;
+    while (j >= 0) {
+      w--;
+      ExpKey deg = deg_of(j);
+      if (i >= 0 and less(deg, degs[i])) {
+        cfs[w] = std::move(cfs[i]);
+        degs[w] = degs[i];
+        i--;
+      } else if (i >= 0 and degs[i] == deg) {
+        cfs[w] = cfs[i] + cf_of(j);
+        degs[w] = deg;
+        i--;
+        j--;
+      } else {
+        cfs[w] = cf_of(j);
+        degs[w] = deg;
+        j--;
+      }
+    }
+    // [0, i] не двигались, слитое лежит в [w, n + m): сдвигаем к ним, выбрасывая сократившиеся
+    int out = i + 1;
+    for (int k = w; k < n + m; k++) {
+      if (!Ring<R>::IsZero(cfs[k])) {
+        if (out != k) {
+          cfs[out] = std::move(cfs[k]);
+          degs[out] = degs[k];
+        }
+        out++;
+      }
+    }
+    cfs.resize(out);
+    degs.resize(out);
+  }
+
+ public:
+  R &Cf(int ind) {
+    return cfs[ind];
+  }
+
+  const R &Cf(int ind) const {
+    return cfs[ind];
+  }
+
+  ExpKey &Deg(int ind) {
+    return degs[ind];
+  }
+
+  const ExpKey &Deg(int ind) const {
+    return degs[ind];
+  }
+
+  Monomial Get(int ind) const {
+    return Monomial(cfs[ind], degs[ind]);
+  }
+
+  Term operator [](int ind) {
+    return Term{cfs[ind], Deg(ind)};
+  }
+
+  ConstTerm operator [](int ind) const {
+    return ConstTerm{cfs[ind], Deg(ind)};
+  }
+
+  Term back() {
+    return (*this)[GetSize() - 1];
+  }
+
+  ConstTerm back() const {
+    return (*this)[GetSize() - 1];
+  }
+
+  iterator begin() {
+    return iterator(this, 0);
+  }
+
+  iterator end() {
+    return iterator(this, GetSize());
+  }
+
+  const_iterator begin() const {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, GetSize());
+  }
+};
+
+using TermStore = BasicTermStore<long double>;
+
+// Накопитель подобных членов: хеш-таблица с открытой адресацией по ExpKey.
+// В таблице лежат только номера членов, сами члены копятся в рабочих массивах
+// в порядке первого появления; сортировка делается один раз в Extract.
+// Рабочие массивы берутся из mem (по умолчанию см. Scratch), результат — в куче.
+template<typename R>
+class BasicTermAccumulator {
+  std::pmr::vector<int> slots;
+  std::pmr::vector<R> cfs;
+  std::pmr::vector<ExpKey> degs;
+  size_t mask = 0;
+
+  void Rehash(size_t cap) {
+    slots.assign(cap, -1);
+    mask = cap - 1;
+    for (int i = 0; i < (int) degs.size(); i++) {
+      size_t pos = degs[i].Hash() & mask;
+      while (slots[pos] != -1) {
+        pos = (pos + 1) & mask;
+      }
+      slots[pos] = i;
+    }
+  }
+
+ public:
+  explicit BasicTermAccumulator(int expected = 0, std::pmr::memory_resource *mem = Scratch())
+      : slots(mem), cfs(mem), degs(mem) {
+    size_t cap = 16;
+    while (cap < (size_t) expected * 2) {
+      cap *= 2;
+    }
+    cfs.reserve(expected);
+    degs.reserve(expected);
+    Rehash(cap);
+  }
+
+  void Add(const ExpKey &deg, const R &cf) {
+    size_t pos = deg.Hash() & mask;
+    while (slots[pos] != -1) {
+      if (degs[slots[pos]] == deg) {
+        cfs[slots[pos]] += cf;
+        return;
+      }
+      pos = (pos + 1) & mask;
+    }
+    slots[pos] = (int) degs.size();
+    cfs.push_back(cf);
+    degs.push_back(deg);
+    if (degs.size() * 2 > slots.size()) {
+      Rehash(slots.size() * 2);
+    }
+  }
+
+  int GetSize() const {
+    return (int) degs.size();
+  }
+
+  // Забирает накопленные ненулевые (см. Ring::IsZero) члены; при sorted упорядочивает их
+  // в мономиальном порядке order (см. RadixOrder), иначе они идут в порядке появления
+  BasicTermStore<R> Extract(bool sorted, MonomialOrder order = MonomialOrder::Lex) {
+    std::pmr::memory_resource *mem = slots.get_allocator().resource();
+    std::pmr::vector<int> perm(mem);
+    if (sorted) {
+      perm = RadixOrder(degs.data(), (int) degs.size(), order, mem);
+    } else {
+      for (int i = 0; i < (int) degs.size(); i++) {
+        perm.push_back(i);
+      }
+    }
+    int kept = 0;
+    for (int i = 0; i < (int) degs.size(); i++) {
+      kept += !Ring<R>::IsZero(cfs[i]);
+    }
+    BasicTermStore<R> res;
+    res.Reserve(kept);
+    for (int i: perm) {
+      if (!Ring<R>::IsZero(cfs[i])) {
+        res.PushBack(cfs[i], degs[i]);
+      }
+    }
+    cfs.clear();
+    degs.clear();
+    Rehash(slots.size());
+    return res;
+  }
+};
+
+using TermAccumulator = BasicTermAccumulator<long double>;
+
+// Умножение отсортированных массивов членов кучей (алгоритм Джонсона).
+// В куче живёт не больше одного кандидата на каждый член меньшего множителя,
+// члены произведения выходят уже по возрастанию ExpKey и сразу складываются.
+// Куча и растущий результат живут в mem, в кучу результат переносится одним куском.
+// Подходит любой мономиальный порядок: умножение на член его сохраняет.
+template<typename R>
+BasicTermStore<R> HeapMultiply(const BasicTermStore<R> &first, const BasicTermStore<R> &second,
+                               std::pmr::memory_resource *mem = Scratch(),
+                               MonomialOrder order = MonomialOrder::Lex) {
+  const BasicTermStore<R> &a = first.GetSize() <= second.GetSize() ? first : second;
+  const BasicTermStore<R> &b = first.GetSize() <= second.GetSize() ? second : first;
+  BasicTermStore<R> res;
+  if (a.Empty()) {
+    return res;
+  }
+
+  struct Node {
+    ExpKey deg;
+    int i;
+    int j;
+  };
+  OrderLess less{order};
+  auto greater = [less](const Node &x, const Node &y) {
+    return less(y.deg, x.deg);
+  };
+  std::pmr::vector<Node> heap(mem);
+  heap.reserve(a.GetSize());
+  heap.push_back(Node{a.Deg(0) + b.Deg(0), 0, 0});
+  std::pmr::vector<R> cfs(mem);
+  std::pmr::vector<ExpKey> degs(mem);
+
+  // каждый член кучи — одно из a.GetSize() * b.GetSize() попарных произведений
+  double total = (double) a.GetSize() * b.GetSize();
+  long long popped = 0;
+  while (!heap.empty()) {
+    if ((++popped & 4095) == 0) {
+      JobCheckpoint(popped / total);
+    }
+    std::pop_heap(heap.begin(), heap.end(), greater);
+    Node top = heap.back();
+    heap.pop_back();
+
+    R cf = a.Cf(top.i) * b.Cf(top.j);
+    if (!cfs.empty() and degs.back() == top.deg) {
+      cfs.back() += cf;
+    } else {
+      if (!cfs.empty() and Ring<R>::IsZero(cfs.back())) {
+        cfs.pop_back();
+        degs.pop_back();
+      }
+      cfs.push_back(std::move(cf));
+      degs.push_back(top.deg);
+    }
+
+    // (i, 0) открывает строку i + 1, (i, j) двигается к (i, j + 1)
+    if (top.j == 0 and top.i + 1 < a.GetSize()) {
+      heap.push_back(Node{a.Deg(top.i + 1) + b.Deg(0), top.i + 1, 0});
+      std::push_heap(heap.begin(), heap.end(), greater);
+    }
+    if (top.j + 1 < b.GetSize()) {
+      heap.push_back(Node{a.Deg(top.i) + b.Deg(top.j + 1), top.i, top.j + 1});
+      std::push_heap(heap.begin(), heap.end(), greater);
+    }
+  }
+  if (!cfs.empty() and Ring<R>::IsZero(cfs.back())) {
+    cfs.pop_back();
+    degs.pop_back();
+  }
+  res.Reserve((int) cfs.size());
+  for (size_t k = 0; k < cfs.size(); k++) {
+    res.PushBack(std::move(cfs[k]), degs[k]);
+  }
+  return res;
+}
+
+// Деление f на набор делителей, упорядоченных, как и f, по order: f = sum q_i * divisors[i] + r,
+// и ни один член r не делится на старший член какого-либо делителя. Старший член f делится
+// на первый подходящий делитель, иначе уходит в остаток. Старший член вычитается точно
+// (выбрасывается, а не сокращается), так что неточный long double не зацикливает деление.
+// quotients (если не nullptr) получает по частному на каждый делитель.
+template<typename R>
+BasicTermStore<R> ReduceBySet(BasicTermStore<R> f, const std::vector<const BasicTermStore<R> *> &divisors,
+                              MonomialOrder order, std::vector<BasicTermStore<R> > *quotients = nullptr) {
+  // члены частных и остатка появляются по убыванию, в конце их остаётся развернуть
+  std::vector<BasicTermStore<R> > desc(divisors.size());
+  BasicTermStore<R> rem;
+  while (!f.Empty()) {
+    JobCheckpoint();
+    ExpKey lead = f.back().deg;
+    int k = 0;
+    while (k < (int) divisors.size() and (divisors[k]->Empty() or !divisors[k]->back().deg.Divides(lead))) {
+      k++;
+    }
+    if (k == (int) divisors.size()) {
+      rem.PushBack(f.back().cf, lead);
+      f.PopBack();
+      continue;
+    }
+    const BasicTermStore<R> &g = *divisors[k];
+    R coef = f.back().cf / g.back().cf;
+    ExpKey shift = lead - g.back().deg;
+    desc[k].PushBack(coef, shift);
+    f.PopBack();
+    f.MergeScaled(g, -coef, shift, order, g.GetSize() - 1);
+  }
+  auto reversed = [](const BasicTermStore<R> &a) {
+    BasicTermStore<R> res;
+    res.Reserve(a.GetSize());
+    for (int i = a.GetSize() - 1; i >= 0; i--) {
+      res.PushBack(a.Cf(i), a.Deg(i));
+    }
+    return res;
+  };
+  if (quotients) {
+    quotients->clear();
+    for (auto &q: desc) {
+      quotients->push_back(reversed(q));
+    }
+  }
+  return reversed(rem);
+}
+
+void SchoolbookMultiply(const long double *a, int n, const long double *b, int m, long double *res) {
+  for (int i = 0; i < n; i++) {
+    if (a[i] == 0) {
+      continue;
+    }
+    for (int j = 0; j < m; j++) {
+      res[i + j] += a[i] * b[j];
+    }
+  }
+}
+
+// Рабочая память KaratsubaMultiply для длины n: 8k на уровень, k = n - n / 2
+int KaratsubaScratch(int n) {
+  int size = 0;
+  while (n > KaratsubaThreshold) {
+    n -= n / 2;
+    size += 8 * n;
+  }
+  return size;
+}
+
+// res += a * b, где a и b длины n; buf — рабочая память не меньше KaratsubaScratch(n),
+// из неё же берутся и промежуточные произведения всех уровней рекурсии
+void KaratsubaMultiply(const long double *a, const long double *b, int n, long double *res, long double *buf) {
+  if (n <= KaratsubaThreshold) {
+    SchoolbookMultiply(a, n, b, n, res);
+    return;
+  }
+  int h = n / 2;
+  int k = n - h;
+  long double *sa = buf;
+  long double *sb = buf + k;
+  long double *mid = buf + 2 * k;
+  long double *low = buf + 4 * k;
+  long double *high = buf + 6 * k;
+  long double *rest = buf + 8 * k;
+  for (int i = 0; i < k; i++) {
+    sa[i] = a[h + i] + (i < h ? a[i] : 0);
+    sb[i] = b[h + i] + (i < h ? b[i] : 0);
+  }
+  std::fill(mid, mid + 2 * k - 1, 0.0L);
+  KaratsubaMultiply(sa, sb, k, mid, rest);
+
+  std::fill(low, low + 2 * h - 1, 0.0L);
+  std::fill(high, high + 2 * k - 1, 0.0L);
+  KaratsubaMultiply(a, b, h, low, rest);
+  KaratsubaMultiply(a + h, b + h, k, high, rest);
+  for (int i = 0; i < 2 * h - 1; i++) {
+    res[i] += low[i];
+    mid[i] -= low[i];
+  }
+  for (int i = 0; i < 2 * k - 1; i++) {
+    res[2 * h + i] += high[i];
+    mid[i] -= high[i];
+  }
+  for (int i = 0; i < 2 * k - 1; i++) {
+    res[h + i] += mid[i];
+  }
+}
+
+// Рабочий массив корней берётся из той же памяти, что и a
+void Fft(std::pmr::vector<std::complex<double> > &a, bool invert) {
+  int n = (int) a.size();
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(a[i], a[j]);
+    }
+  }
+  // корни считаются напрямую через cos/sin, а не степенями, чтобы не копить ошибку
+  std::pmr::vector<std::complex<double> > roots(n / 2 > 0 ? n / 2 : 1, a.get_allocator());
+  for (int i = 0; i < n / 2; i++) {
+    double ang = 2 * M_PI * i / n * (invert ? -1 : 1);
+    roots[i] = std::complex<double>(std::cos(ang), std::sin(ang));
+  }
+  for (int len = 2; len <= n; len <<= 1) {
+    int step = n / len;
+    for (int i = 0; i < n; i += len) {
+      for (int j = 0; j < len / 2; j++) {
+        std::complex<double> u = a[i + j];
+        std::complex<double> v = a[i + j + len / 2] * roots[j * step];
+        a[i + j] = u + v;
+        a[i + j + len / 2] = u - v;
+      }
+    }
+  }
+  if (invert) {
+    for (auto &x: a) {
+      x /= n;
+    }
+  }
+}
+
+// Свёртка через одно прямое и одно обратное БПФ: a кладётся в действительную часть, b — в мнимую
+void FftMultiply(const long double *a, int n, const long double *b, int m, long double *res,
+                 std::pmr::memory_resource *mem = Scratch()) {
+  int sz = 1;
+  while (sz < n + m - 1) {
+    sz <<= 1;
+  }
+  std::pmr::vector<std::complex<double> > f(sz, mem);
+  long double max_a = 0;
+  long double max_b = 0;
+  bool integral = true;
+  for (int i = 0; i < n; i++) {
+    max_a = std::max(max_a, std::abs(a[i]));
+    integral = integral and a[i] == std::floor(a[i]);
+  }
+  for (int i = 0; i < m; i++) {
+    max_b = std::max(max_b, std::abs(b[i]));
+    integral = integral and b[i] == std::floor(b[i]);
+  }
+  if (max_a == 0 or max_b == 0) {
+    return;
+  }
+  // ошибка БПФ в double — порядка bound * log2(sz) * 2^-53; у целых входов она должна быть
+  // заметно меньше 1/2, чтобы округление давало точный ответ
+  long double bound = max_a * max_b * std::min(n, m);
+  int log_sz = std::max(1, std::ilogb(sz));
+  bool exact = integral and std::scalbn(bound * log_sz, -53) < 0.125L;
+  if (integral and !exact) {
+    // больший вход режется на две половины разрядов x = hi * 2^s + lo, и каждая половина
+    // умножается отдельно (рекурсивно режется дальше, пока граница не станет безопасной)
+    bool split_a = max_a >= max_b;
+    const long double *x = split_a ? a : b;
+    const long double *y = split_a ? b : a;
+    int nx = split_a ? n : m, ny = split_a ? m : n;
+    long double base = std::scalbn(1.0L, (std::ilogb(std::max(max_a, max_b)) + 1) / 2);
+    std::pmr::vector<long double> lo(nx, mem), hi(nx, mem);
+    for (int i = 0; i < nx; i++) {
+      lo[i] = std::fmod(x[i], base);
+      hi[i] = (x[i] - lo[i]) / base;
+    }
+    std::pmr::vector<long double> lo_res(n + m - 1, 0.0L, mem), hi_res(n + m - 1, 0.0L, mem);
+    FftMultiply(lo.data(), nx, y, ny, lo_res.data(), mem);
+    FftMultiply(hi.data(), nx, y, ny, hi_res.data(), mem);
+    for (int i = 0; i < n + m - 1; i++) {
+      res[i] += hi_res[i] * base + lo_res[i];
+    }
+    return;
+  }
+  // ошибка упаковки двух входов в один комплексный массив растёт как квадрат большего из них,
+  // поэтому оба входа точно (степенями двойки) приводятся к порядку единицы
+  int exp_a = std::ilogb(max_a);
+  int exp_b = std::ilogb(max_b);
+  for (int i = 0; i < n; i++) {
+    f[i].real((double) std::scalbn(a[i], -exp_a));
+  }
+  for (int i = 0; i < m; i++) {
+    f[i].imag((double) std::scalbn(b[i], -exp_b));
+  }
+  Fft(f, false);
+  std::pmr::vector<std::complex<double> > g(sz, mem);
+  for (int i = 0; i < sz; i++) {
+    std::complex<double> x = f[i];
+    std::complex<double> y = std::conj(f[(sz - i) & (sz - 1)]);
+    g[i] = (x * x - y * y) * std::complex<double>(0, -0.25);
+  }
+  Fft(g, true);
+  // у целых входов результат округляется до точного, иначе отбрасывается то, что не отличить от шума БПФ
+  long double noise = bound * 1e-13L;
+  for (int i = 0; i < n + m - 1; i++) {
+    long double val = std::scalbn((long double) g[i].real(), exp_a + exp_b);
+    if (exact) {
+      val = std::round(val);
+    } else if (std::abs(val) <= noise) {
+      val = 0;
+    }
+    res[i] += val;
+  }
+}
+
+// Произведение плотных массивов коэффициентов, алгоритм выбирается по порогам; рабочая память — из mem
+std::vector<long double> DenseMultiply(const std::vector<long double> &first, const std::vector<long double> &second,
+                                       std::pmr::memory_resource *mem = Scratch()) {
+  const std::vector<long double> &a = first.size() >= second.size() ? first : second;
+  const std::vector<long double> &b = first.size() >= second.size() ? second : first;
+  int n = (int) a.size();
+  int m = (int) b.size();
+  if (m == 0) {
+    return {};
+  }
+  std::vector<long double> res(n + m - 1, 0.0L);
+  if (m <= KaratsubaThreshold) {
+    SchoolbookMultiply(a.data(), n, b.data(), m, res.data());
+  } else if (n + m - 1 >= FftThreshold) {
+    FftMultiply(a.data(), n, b.data(), m, res.data(), mem);
+  } else {
+    // длинный множитель режется на куски длины m, каждый кусок — Карацуба m x m
+    std::pmr::vector<long double> chunk(m, mem);
+    std::pmr::vector<long double> part(2 * m - 1, mem);
+    std::pmr::vector<long double> buf(KaratsubaScratch(m), mem);
+    for (int start = 0; start < n; start += m) {
+      int len = std::min(m, n - start);
+      std::fill(chunk.begin(), chunk.end(), 0.0L);
+      std::copy(a.begin() + start, a.begin() + start + len, chunk.begin());
+      std::fill(part.begin(), part.end(), 0.0L);
+      KaratsubaMultiply(chunk.data(), b.data(), m, part.data(), buf.data());
+      for (int i = 0; i < len + m - 1; i++) {
+        res[start + i] += part[i];
+      }
+    }
+  }
+  return res;
+}
+
+// 1 / f mod x^k итерацией Ньютона g = g * (2 - f * g), точность удваивается на каждом шаге
+std::vector<long double> DenseInverseSeries(const std::vector<long double> &f, int k) {
+  std::vector<long double> g(1, 1 / f[0]);
+  int len = 1;
+  while (len < k and std::isfinite(g.back())) {
+    len = std::min(2 * len, k);
+    std::vector<long double> head(f.begin(), f.begin() + std::min<size_t>(len, f.size()));
+    std::vector<long double> e = DenseMultiply(head, g);
+    e.resize(len, 0.0L);
+    for (auto &x: e) {
+      x = -x;
+    }
+    e[0] += 2;
+    g = DenseMultiply(g, e);
+    g.resize(len, 0.0L);
+  }
+  return g;
+}
+
+// Деление через обратный ряд. Ряд 1 / rev(b) растёт как степени корней b,
+// лежащих вне единичного круга, поэтому ответ проверяется по невязке a - b * q;
+// если она не сошлась, возвращается false и вызывающий делит столбиком.
+bool NewtonDivide(std::vector<long double> &a, const std::vector<long double> &b, std::vector<long double> &q) {
+  int n = (int) a.size();
+  int m = (int) b.size();
+  int k = n - m + 1;
+  std::vector<long double> rb(b.rbegin(), b.rend());
+  std::vector<long double> ra(a.rbegin(), a.rbegin() + k);
+  std::vector<long double> rq = DenseMultiply(ra, DenseInverseSeries(rb, k));
+  rq.resize(k, 0.0L);
+  q.assign(rq.rbegin(), rq.rend());
+  std::vector<long double> bq = DenseMultiply(b, q);
+  bq.resize(n, 0.0L);
+  long double max_a = 1;
+  for (auto x: a) {
+    max_a = std::max(max_a, std::abs(x));
+  }
+  for (int i = m - 1; i < n; i++) {
+    long double diff = std::abs(a[i] - bq[i]);
+    if (!(diff <= EPS * max_a)) {
+      return false;
+    }
+  }
+  for (int i = 0; i < m - 1; i++) {
+    a[i] -= bq[i];
+  }
+  return true;
+}
+
+// Деление с остатком плотных массивов коэффициентов; у b старший коэффициент ненулевой.
+// Короткие задачи делятся столбиком на месте, длинные сначала пробуют NewtonDivide.
+std::pair<std::vector<long double>, std::vector<long double> > DenseDivide(std::vector<long double> a,
+                                                                        const std::vector<long double> &b) {
+  int n = (int) a.size();
+  int m = (int) b.size();
+  if (n < m) {
+    return make_pair_custom(std::vector<long double>(), a);
+  }
+  int k = n - m + 1;
+  std::vector<long double> q(k, 0.0L);
+  if (std::min(k, m) < NewtonDivThreshold or !NewtonDivide(a, b, q)) {
+    long double lead = b.back();
+    std::fill(q.begin(), q.end(), 0.0L);
+    for (int i = k - 1; i >= 0; i--) {
+      if ((i & 1023) == 0) {
+        JobCheckpoint((double) (k - i) / k);
+      }
+      long double c = a[i + m - 1] / lead;
+      q[i] = c;
+      if (c != 0) {
+        for (int j = 0; j < m - 1; j++) {
+          a[i + j] -= c * b[j];
+        }
+      }
+    }
+  }
+  a.resize(m - 1);
+  for (auto *part: {&q, &a}) {
+    for (auto &x: *part) {
+      if (std::abs(x) <= EPS) {
+        x = 0;
+      }
+    }
+  }
+  return make_pair_custom(q, a);
+}
+
+// Скомпилированный план вычисления многочлена (программа без ветвлений).
+// Степени каждой переменной считаются одной цепочкой умножений через квадраты, без pow;
+// члены идут в лексикографическом порядке, и произведение общего префикса множителей
+// с предыдущим членом не пересчитывается.
+class EvalPlan {
+  friend class Polynomial;
+
+  struct Op {
+    int dst;
+    int a;
+    int b;
+  };
+
+  // регистр 0 — единица, регистр 1 + i — значение переменной vars[i]
+  std::vector<int> vars;
+  std::vector<Op> ops;
+  std::vector<long double> cfs;
+  // множители члена t — регистры factors[factor_begin[t] .. factor_begin[t + 1])
+  std::vector<int> factor_begin;
+  std::vector<int> factors;
+  // сколько первых множителей у члена t общие с членом t - 1
+  std::vector<int> shared;
+  int reg_count = 1;
+  int max_depth = 0;
+  std::vector<double> cfs_double;
+
+  MULTI_ISA void EvaluateBlock(const double *const *columns, long long start, int cnt,
+                               double *out, double *buf) const;
+
+ public:
+  // Точек в одном блоке пакетного вычисления: все регистры плана хранятся по EvalBlock значений,
+  // и каждая операция плана — один векторизуемый цикл по блоку
+  static const int EvalBlock = 64;
+
+  // Пакетное вычисление в n точках. columns[v] — массив значений переменной v ('a' + v)
+  // длины n либо nullptr, если переменная не задана. Большие пакеты делятся между потоками пула.
+  void EvaluateBatch(const double *const *columns, long long n, double *out) const;
+
+  // Размер рабочего буфера для Evaluate(values, buf)
+  int ScratchSize() const {
+    return reg_count + max_depth + 1;
+  }
+
+  // values индексируются буквой переменной, как в Polynomial::GetY; INF означает "не задана"
+  long double Evaluate(const long double *values, long double *buf) const {
+    buf[0] = 1;
+    for (int i = 0; i < (int) vars.size(); i++) {
+      long double x = values[vars[i]];
+      buf[1 + i] = (x == INF ? 1 : x);
+    }
+    for (const Op &op: ops) {
+      buf[op.dst] = buf[op.a] * buf[op.b];
+    }
+    long double *prefix = buf + reg_count;
+    prefix[0] = 1;
+    long double res = 0;
+    for (int t = 0; t < (int) cfs.size(); t++) {
+      int d = shared[t];
+      for (int f = factor_begin[t] + d; f < factor_begin[t + 1]; f++, d++) {
+        prefix[d + 1] = prefix[d] * buf[factors[f]];
+      }
+      res += cfs[t] * prefix[d];
+    }
+    return res;
+  }
+
+  // Рабочий буфер свой у каждого потока, так что один план можно вычислять параллельно
+  long double Evaluate(const std::vector<long double> &values) const {
+    static thread_local std::vector<long double> scratch;
+    if ((int) scratch.size() < ScratchSize()) {
+      scratch.resize(ScratchSize());
+    }
+    return Evaluate(values.data(), scratch.data());
+  }
+};
+
+void EvalPlan::EvaluateBlock(const double *const *columns, long long start, int cnt,
+                             double *out, double *buf) const {
+  const int B = EvalBlock;
+  double *regs = buf;
+  double *prefix = buf + (size_t) reg_count * B;
+  for (int k = 0; k < B; k++) {
+    regs[k] = 1;
+  }
+  for (int i = 0; i < (int) vars.size(); i++) {
+    const double *col = columns[vars[i]];
+    double *dst = regs + (size_t) (1 + i) * B;
+    for (int k = 0; k < B; k++) {
+      dst[k] = (col != nullptr and k < cnt) ? col[start + k] : 1;
+    }
+  }
+  for (const Op &op: ops) {
+    double *dst = regs + (size_t) op.dst * B;
+    const double *a = regs + (size_t) op.a * B;
+    const double *b = regs + (size_t) op.b * B;
+    for (int k = 0; k < B; k++) {
+      dst[k] = a[k] * b[k];
+    }
+  }
+  double acc[B];
+  for (int k = 0; k < B; k++) {
+    acc[k] = 0;
+    prefix[k] = 1;
+  }
+  for (int t = 0; t < (int) cfs_double.size(); t++) {
+    int d = shared[t];
+    for (int f = factor_begin[t] + d; f < factor_begin[t + 1]; f++, d++) {
+      const double *x = regs + (size_t) factors[f] * B;
+      const double *p = prefix + (size_t) d * B;
+      double *q = prefix + (size_t) (d + 1) * B;
+      for (int k = 0; k < B; k++) {
+        q[k] = p[k] * x[k];
+      }
+    }
+    double cf = cfs_double[t];
+    const double *p = prefix + (size_t) d * B;
+    for (int k = 0; k < B; k++) {
+      acc[k] += cf * p[k];
+    }
+  }
+  for (int k = 0; k < cnt; k++) {
+    out[start + k] = acc[k];
+  }
+}
+
+void EvalPlan::EvaluateBatch(const double *const *columns, long long n, double *out) const {
+  long long blocks = (n + EvalBlock - 1) / EvalBlock;
+  size_t buf_size = (size_t) ScratchSize() * EvalBlock;
+  auto body = [&](long long begin, long long end) {
+    std::vector<double> buf(buf_size);
+    for (long long blk = begin; blk < end; blk++) {
+      long long start = blk * EvalBlock;
+      EvaluateBlock(columns, start, (int) std::min<long long>(EvalBlock, n - start), out, buf.data());
+    }
+  };
+  // мелкие пакеты не стоят синхронизации потоков
+  if (n < (1 << 14)) {
+    body(0, blocks);
+  } else {
+    DefaultPool().ParallelFor(blocks, 64, body);
+  }
+}
+
+uint64_t MulMod(uint64_t a, uint64_t b, uint64_t mod) {
+  return (uint64_t) ((unsigned __int128) a * b % mod);
+}
+
+uint64_t PowMod(uint64_t a, uint64_t e, uint64_t mod) {
+  uint64_t res = 1 % mod;
+  a %= mod;
+  while (e > 0) {
+    if (e & 1) {
+      res = MulMod(res, a, mod);
+    }
+    a = MulMod(a, a, mod);
+    e >>= 1;
+  }
+  return res;
+}
+
+// Детерминированный тест Миллера-Рабина для 64-битных чисел
+bool IsPrime64(uint64_t n) {
+  if (n < 2) {
+    return false;
+  }
+  for (uint64_t p: {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+    if (n % p == 0) {
+      return n == p;
+    }
+  }
+  uint64_t d = n - 1;
+  int s = 0;
+  while ((d & 1) == 0) {
+    d >>= 1;
+    s++;
+  }
+  for (uint64_t a: {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+    uint64_t x = PowMod(a, d, n);
+    if (x == 1 or x == n - 1) {
+      continue;
+    }
+    bool composite = true;
+    for (int r = 1; r < s and composite; r++) {
+      x = MulMod(x, x, n);
+      composite = (x != n - 1);
+    }
+    if (composite) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Нетривиальный делитель составного n (ро-метод Полларда в варианте Брента)
+uint64_t PollardRho(uint64_t n) {
+  if (n % 2 == 0) {
+    return 2;
+  }
+  for (uint64_t c = 1;; c++) {
+    auto f = [n, c](uint64_t x) {
+      return (MulMod(x, x, n) + c) % n;
+    };
+    uint64_t x = 2;
+    uint64_t y = 2;
+    uint64_t d = 1;
+    while (d == 1) {
+      // произведение 128 разностей за одно вычисление НОД
+      uint64_t prod = 1;
+      uint64_t xs = x;
+      uint64_t ys = y;
+      for (int i = 0; i < 128; i++) {
+        x = f(x);
+        y = f(f(y));
+        prod = MulMod(prod, x > y ? x - y : y - x, n);
+      }
+      d = std::gcd(prod, n);
+      if (d == n) {
+        // перескочили, повторяем шаги по одному
+        x = xs;
+        y = ys;
+        do {
+          x = f(x);
+          y = f(f(y));
+          d = std::gcd(x > y ? x - y : y - x, n);
+        } while (d == 1);
+      }
+    }
+    if (d != n) {
+      return d;
+    }
+  }
+}
+
+void Factorize(uint64_t n, std::vector<uint64_t> &primes) {
+  if (n <= 1) {
+    return;
+  }
+  for (uint64_t p: {2, 3, 5, 7, 11, 13}) {
+    while (n % p == 0) {
+      primes.push_back(p);
+      n /= p;
+    }
+  }
+  if (n == 1) {
+    return;
+  }
+  if (IsPrime64(n)) {
+    primes.push_back(n);
+    return;
+  }
+  uint64_t d = PollardRho(n);
+  Factorize(d, primes);
+  Factorize(n / d, primes);
+}
+
+std::vector<uint64_t> Divisors(uint64_t n) {
+  std::vector<uint64_t> primes;
+  Factorize(n, primes);
+  std::sort(primes.begin(), primes.end());
+  std::vector<uint64_t> res(1, 1);
+  for (size_t i = 0; i < primes.size();) {
+    size_t j = i;
+    while (j < primes.size() and primes[j] == primes[i]) {
+      j++;
+    }
+    size_t old = res.size();
+    uint64_t pw = 1;
+    for (size_t k = i; k < j; k++) {
+      pw *= primes[i];
+      for (size_t t = 0; t < old; t++) {
+        res.push_back(res[t] * pw);
+      }
+    }
+    i = j;
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+// q^n * a(p / q) по модулю mod (однородная схема Горнера)
+uint64_t EvalRationalMod(const std::vector<__int128> &a, long long p, long long q, uint64_t mod) {
+  auto reduce = [mod](__int128 x) {
+    x %= (__int128) mod;
+    return (uint64_t) (x < 0 ? x + mod : x);
+  };
+  uint64_t pm = reduce(p);
+  uint64_t qm = reduce(q);
+  uint64_t h = 0;
+  uint64_t qpow = 1;
+  for (int i = (int) a.size() - 1; i >= 0; i--) {
+    h = (MulMod(h, pm, mod) + MulMod(reduce(a[i]), qpow, mod)) % mod;
+    qpow = MulMod(qpow, qm, mod);
+  }
+  return h;
+}
+
+// Точное деление на (q x - p) снизу вверх: a(x) = (q x - p) c(x). При успехе a заменяется на c.
+bool DeflateRational(std::vector<__int128> &a, long long p, long long q) {
+  int n = (int) a.size() - 1;
+  std::vector<__int128> c(n);
+  __int128 prev = 0;
+  for (int k = 0; k < n; k++) {
+    // a_k = q c_{k-1} - p c_k
+    __int128 num;
+    if (__builtin_mul_overflow(prev, (__int128) q, &num) or __builtin_sub_overflow(num, a[k], &num)) {
+      return false;
+    }
+    if (num % p != 0) {
+      return false;
+    }
+    c[k] = num / p;
+    prev = c[k];
+  }
+  __int128 lead;
+  if (__builtin_mul_overflow(prev, (__int128) q, &lead) or lead != a[n]) {
+    return false;
+  }
+  a = c;
+  return true;
+}
+
+// Все рациональные корни p / q (q > 0, НОД(p, q) = 1) многочлена с целыми коэффициентами a[0..n].
+// Кандидаты берутся по теореме о рациональных корнях, отсекаются оценкой Коши,
+// делимостью a(1) на q - p и a(-1) на q + p и значением по модулю нескольких простых,
+// а подтверждаются точным делением, после которого многочлен понижается.
+std::vector<std::pair<long long, long long> > ExactRationalRoots(std::vector<__int128> a, bool integer_only) {
+  std::vector<std::pair<long long, long long> > res;
+  while (!a.empty() and a.back() == 0) {
+    a.pop_back();
+  }
+  if (a.size() <= 1) {
+    return res;
+  }
+  size_t shift = 0;
+  while (a[shift] == 0) {
+    shift++;
+  }
+  if (shift > 0) {
+    res.push_back(make_pair_custom(0LL, 1LL));
+    a.erase(a.begin(), a.begin() + shift);
+  }
+  auto abs128 = [](__int128 x) {
+    return x < 0 ? -x : x;
+  };
+  const uint64_t mods[] = {998244353ULL, 1000000007ULL, 2305843009213693951ULL};
+  std::vector<uint64_t> ps = Divisors((uint64_t) abs128(a[0]));
+  std::vector<uint64_t> qs(1, 1);
+  if (!integer_only) {
+    qs = Divisors((uint64_t) abs128(a.back()));
+  }
+  for (uint64_t q: qs) {
+    for (uint64_t p_abs: ps) {
+      if (a.size() <= 1) {
+        return res;
+      }
+      if (std::gcd(p_abs, q) != 1) {
+        continue;
+      }
+      // |p / q| <= 1 + max |a_i / a_n|
+      __int128 max_cf = 0;
+      __int128 sum = 0;
+      __int128 alt = 0;
+      // при переполнении a(1) или a(-1) отсев по делимости пропускается
+      bool sums = true;
+      for (size_t i = 0; i < a.size(); i++) {
+        max_cf = std::max(max_cf, abs128(a[i]));
+        sums = sums and !__builtin_add_overflow(sum, a[i], &sum);
+        sums = sums and !__builtin_add_overflow(alt, i % 2 == 0 ? a[i] : -a[i], &alt);
+      }
+      // целая оценка 1 + ceil(max / |a_n|); произведение с q, вышедшее за __int128, заведомо больше p
+      __int128 lead = abs128(a.back());
+      __int128 cauchy = 1 + max_cf / lead + (max_cf % lead != 0 ? 1 : 0);
+      __int128 limit;
+      if (!__builtin_mul_overflow((__int128) q, cauchy, &limit) and (__int128) p_abs > limit) {
+        continue;
+      }
+      for (int sign: {1, -1}) {
+        long long p = sign * (long long) p_abs;
+        __int128 at_one = (__int128) q - p;
+        __int128 at_minus_one = (__int128) q + p;
+        if (sums and ((at_one == 0 ? sum != 0 : sum % at_one != 0) or
+                      (at_minus_one == 0 ? alt != 0 : alt % at_minus_one != 0))) {
+          continue;
+        }
+        bool zero = true;
+        for (uint64_t mod: mods) {
+          zero = zero and EvalRationalMod(a, p, (long long) q, mod) == 0;
+        }
+        if (zero and DeflateRational(a, p, (long long) q)) {
+          res.push_back(make_pair_custom(p, (long long) q));
+        }
+      }
+    }
+  }
+  std::sort(res.begin(), res.end(), [](const std::pair<long long, long long> &x,
+                                       const std::pair<long long, long long> &y) {
+    return (__int128) x.first * y.second < (__int128) y.first * x.second;
+  });
+  return res;
+}
+
+// p(z) / p'(z) для плотного многочлена a. При |z| > 1 считается через перевёрнутый
+// многочлен R(w) = w^n p(1 / w), чтобы схема Горнера не переполнялась на высоких степенях.
+std::complex<long double> NewtonRatio(const std::vector<long double> &a, std::complex<long double> z) {
+  int n = (int) a.size() - 1;
+  std::complex<long double> p = 0;
+  std::complex<long double> dp = 0;
+  if (std::abs(z) <= 1) {
+    for (int i = n; i >= 0; i--) {
+      dp = dp * z + p;
+      p = p * z + a[i];
+    }
+    return p / dp;
+  }
+  std::complex<long double> w = 1.0L / z;
+  for (int i = 0; i <= n; i++) {
+    dp = dp * w + p;
+    p = p * w + a[i];
+  }
+  // p'(z) / p(z) = w (n - w R'(w) / R(w))
+  return 1.0L / (w * ((long double) n - w * dp / p));
+}
+
+// Все комплексные корни методом Аберта-Эрлиха. Начальные приближения лежат на окружностях,
+// радиусы которых берутся из многоугольника Ньютона точек (i, log|a_i|); итерации идут
+// по Якоби, поэтому на больших степенях шаг делится между потоками. В конце — шаги Ньютона.
+std::vector<std::complex<long double> > AberthRoots(std::vector<long double> a, long double tol,
+                                                    int max_iter = 1000) {
+  std::vector<std::complex<long double> > roots;
+  while (!a.empty() and a.back() == 0) {
+    a.pop_back();
+  }
+  size_t shift = 0;
+  while (shift < a.size() and a[shift] == 0) {
+    shift++;
+  }
+  roots.assign(a.empty() ? 0 : shift, 0);
+  a.erase(a.begin(), a.begin() + std::min(shift, a.size()));
+  int n = (int) a.size() - 1;
+  if (n <= 0) {
+    return roots;
+  }
+  long double scale = 0;
+  for (auto x: a) {
+    scale = std::max(scale, std::abs(x));
+  }
+  for (auto &x: a) {
+    x /= scale;
+  }
+
+  std::vector<int> hull;
+  for (int i = 0; i <= n; i++) {
+    if (a[i] == 0) {
+      continue;
+    }
+    auto y = [&a](int k) {
+      return std::log(std::abs(a[k]));
+    };
+    while (hull.size() >= 2) {
+      int p = hull[hull.size() - 2];
+      int q = hull.back();
+      if ((y(q) - y(p)) * (i - q) <= (y(i) - y(q)) * (q - p)) {
+        hull.pop_back();
+      } else {
+        break;
+      }
+    }
+    hull.push_back(i);
+  }
+  std::vector<std::complex<long double> > z;
+  z.reserve(n);
+  for (size_t h = 0; h + 1 < hull.size(); h++) {
+    int i = hull[h];
+    int j = hull[h + 1];
+    long double radius = std::pow(std::abs(a[i] / a[j]), 1.0L / (j - i));
+    for (int k = 0; k < j - i; k++) {
+      long double ang = 2 * M_PI * k / (j - i) + 2 * M_PI * h / n + 0.4L;
+      z.push_back(std::polar(radius, ang));
+    }
+  }
+
+  std::vector<std::complex<long double> > next(z);
+  std::vector<char> done(n, 0);
+  for (int iter = 0; iter < max_iter; iter++) {
+    std::atomic<int> active{0};
+    auto body = [&](long long begin, long long end) {
+      for (long long i = begin; i < end; i++) {
+        if (done[i]) {
+          next[i] = z[i];
+          continue;
+        }
+        std::complex<long double> ratio = NewtonRatio(a, z[i]);
+        std::complex<long double> sum = 0;
+        for (int j = 0; j < n; j++) {
+          if (j != i) {
+            sum += 1.0L / (z[i] - z[j]);
+          }
+        }
+        std::complex<long double> step = ratio / (1.0L - ratio * sum);
+        if (!std::isfinite(step.real()) or !std::isfinite(step.imag())) {
+          step = 0;
+        }
+        next[i] = z[i] - step;
+        if (std::abs(step) <= tol * std::max(1.0L, std::abs(z[i]))) {
+          done[i] = 1;
+        } else {
+          active++;
+        }
+      }
+    };
+    if (n >= 256) {
+      DefaultPool().ParallelFor(n, 32, body);
+    } else {
+      body(0, n);
+    }
+    z.swap(next);
+    if (active == 0) {
+      break;
+    }
+    JobCheckpoint((double) (n - active) / n);
+  }
+  for (auto &x: z) {
+    for (int k = 0; k < 2; k++) {
+      std::complex<long double> step = NewtonRatio(a, x);
+      if (std::isfinite(step.real()) and std::isfinite(step.imag())) {
+        x -= step;
+      }
+    }
+    roots.push_back(x);
+  }
+  return roots;
+}
+
+// Остаток от деления a на b для ряда Штурма: столбиком, без обнуления по абсолютному EPS.
+// Старшие коэффициенты остатка отбрасываются, только если они не больше погрешности
+// вычитаний, оцениваемой по нормам a, b и частного.
+std::vector<long double> SturmRemainder(std::vector<long double> a, const std::vector<long double> &b) {
+  int n = (int) a.size();
+  int m = (int) b.size();
+  if (n < m) {
+    return a;
+  }
+  long double norm_a = 0;
+  long double norm_b = 0;
+  long double norm_q = 0;
+  for (auto x: a) {
+    norm_a = std::max(norm_a, std::abs(x));
+  }
+  for (auto x: b) {
+    norm_b = std::max(norm_b, std::abs(x));
+  }
+  for (int i = n - m; i >= 0; i--) {
+    long double c = a[i + m - 1] / b.back();
+    norm_q = std::max(norm_q, std::abs(c));
+    for (int j = 0; j < m - 1; j++) {
+      a[i + j] -= c * b[j];
+    }
+  }
+  a.resize(m - 1);
+  long double tol = 8 * n * LDBL_EPSILON * (norm_a + norm_q * norm_b);
+  while (!a.empty() and std::abs(a.back()) <= tol) {
+    a.pop_back();
+  }
+  return a;
+}
+
+// Интервалы (lo, hi] шириной не больше precision, в каждом ровно один различный
+// вещественный корень (считается по ряду Штурма); кластер, который не разделить
+// в точности long double, возвращается одним интервалом.
+std::vector<std::pair<long double, long double> > SturmIsolate(std::vector<long double> a, long double precision) {
+  std::vector<std::pair<long double, long double> > res;
+  while (!a.empty() and a.back() == 0) {
+    a.pop_back();
+  }
+  if (a.size() <= 1) {
+    return res;
+  }
+  auto normalize = [](std::vector<long double> &p) {
+    long double mx = 0;
+    for (auto x: p) {
+      mx = std::max(mx, std::abs(x));
+    }
+    for (auto &x: p) {
+      x /= mx;
+    }
+  };
+  normalize(a);
+  std::vector<std::vector<long double> > chain;
+  chain.push_back(a);
+  std::vector<long double> da(a.size() - 1);
+  for (size_t i = 1; i < a.size(); i++) {
+    da[i - 1] = a[i] * i;
+  }
+  normalize(da);
+  chain.push_back(da);
+  while (chain.back().size() > 1) {
+    const std::vector<long double> &b = chain.back();
+    std::vector<long double> r = SturmRemainder(chain[chain.size() - 2], b);
+    if (r.empty()) {
+      break;
+    }
+    for (auto &x: r) {
+      x = -x;
+    }
+    normalize(r);
+    chain.push_back(r);
+  }
+  auto variations = [&chain](long double x) {
+    int cnt = 0;
+    int prev = 0;
+    for (auto &p: chain) {
+      long double v = 0;
+      for (int i = (int) p.size() - 1; i >= 0; i--) {
+        v = v * x + p[i];
+      }
+      int sign = (v > 0) - (v < 0);
+      if (sign != 0) {
+        if (prev != 0 and sign != prev) {
+          cnt++;
+        }
+        prev = sign;
+      }
+    }
+    return cnt;
+  };
+  long double bound = 0;
+  for (auto x: a) {
+    bound = std::max(bound, std::abs(x / a.back()));
+  }
+  bound += 1;
+  struct Segment {
+    long double lo;
+    long double hi;
+    int v_lo;
+    int v_hi;
+  };
+  std::vector<Segment> stack;
+  stack.push_back(Segment{-bound, bound, variations(-bound), variations(bound)});
+  while (!stack.empty()) {
+    Segment s = stack.back();
+    stack.pop_back();
+    int cnt = s.v_lo - s.v_hi;
+    if (cnt <= 0) {
+      continue;
+    }
+    long double mid = s.lo + (s.hi - s.lo) / 2;
+    if ((cnt == 1 and s.hi - s.lo <= precision) or mid <= s.lo or mid >= s.hi) {
+      res.push_back(make_pair_custom(s.lo, s.hi));
+      continue;
+    }
+    int v_mid = variations(mid);
+    stack.push_back(Segment{mid, s.hi, v_mid, s.v_hi});
+    stack.push_back(Segment{s.lo, mid, s.v_lo, v_mid});
+  }
+  return res;
+}
+
+class Polynomial {
+ private:
+  TermStore monos;
+  // порядок, в котором упорядочены члены
+  MonomialOrder order = MonomialOrder::Lex;
+  // план для GetY: строится при первом вычислении, сбрасывается при изменении членов.
+  // Читается и пишется атомарно, потому что GetY константный и может идти из нескольких потоков
+  mutable std::shared_ptr<const EvalPlan> plan;
+
+  std::shared_ptr<const EvalPlan> CachedPlan() const;
+
+  // Сортирует члены в порядке order, складывает подобные и выбрасывает нулевые
+  void Normalize();
+
+  // other в порядке этого многочлена: сам other или его пересортированная копия в buf
+  const Polynomial &Aligned(const Polynomial &other, Polynomial &buf) const;
+
+  bool CheckCntVars() const;
+
+  // Плотный массив коэффициентов по переменной var; член с индексом k — при var^k
+  std::vector<long double> ToDense(int var) const;
+
+  // Члены одной переменной упорядочены одинаково в любом мономиальном порядке
+  static Polynomial FromDense(const std::vector<long double> &cfs, int var,
+                              MonomialOrder order = MonomialOrder::Lex);
+
+  // Целые коэффициенты одномерного многочлена; -1 при успехе, иначе код ошибки FindIntegerRoots
+  int IntegerCoefficients(std::vector<__int128> &a) const;
+
+  friend class PolyCodec;
+
+  template<typename R>
+  friend class BasicPolynomial;
+
+  friend class ModularGroebner;
+
+ public:
+  Polynomial() = default;
+
+  Polynomial(const Polynomial &other)
+      : monos(other.monos), order(other.order), plan(std::atomic_load(&other.plan)) {
+  }
+
+  Polynomial(Polynomial &&) noexcept = default;
+
+  Polynomial &operator =(const Polynomial &other) {
+    monos = other.monos;
+    order = other.order;
+    plan = std::atomic_load(&other.plan);
+    return *this;
+  }
+
+  Polynomial &operator =(Polynomial &&) noexcept = default;
+
+  Polynomial(List<Monomial> a) {
+    monos.Reserve(a.GetSize());
+    for (int i = 0; i < a.GetSize(); i++) {
+      monos.PushBack(a[i]);
+    }
+    // операции полагаются на то, что члены отсортированы и приведены
+    Normalize();
+  };
+
+  MonomialOrder GetOrder() const {
+    return order;
+  }
+
+  // Пересортировывает члены в новом порядке; результаты операций берут порядок левого операнда
+  void SetOrder(MonomialOrder new_order);
+
+
+  // Бросает строку с описанием ошибки, если запись некорректна
+  Polynomial(std::string_view s);
+
+  long double GetY(
+      const std::vector<long double> &variables) const;
+
+  // Значения в n точках, см. EvalPlan::EvaluateBatch
+  void GetYBatch(const double *const *columns, long long n, double *out) const;
+
+  bool operator ==(const Polynomial &second) const;
+
+  // Временный операнд отдаёт свой буфер под результат: (a * b) + c не копирует произведение
+  Polynomial operator +(const Polynomial &second) const &;
+
+  Polynomial operator +(const Polynomial &second) &&;
+
+  Polynomial operator +(Polynomial &&second) const &;
+
+  Polynomial operator +(Polynomial &&second) &&;
+
+  Polynomial operator -(const Polynomial &second) const &;
+
+  Polynomial operator -(const Polynomial &second) &&;
+
+  Polynomial operator -(Polynomial &&second) const &;
+
+  Polynomial operator -(Polynomial &&second) &&;
+
+  // Сложение и вычитание на месте слиянием; новой памяти нет, если хватает ёмкости
+  Polynomial &operator +=(const Polynomial &second);
+
+  Polynomial &operator -=(const Polynomial &second);
+
+  Polynomial &operator *=(const Polynomial &second);
+
+  std::pair<bool,
+            std::vector<long long> > FindIntegerRoots() const;
+
+  // Рациональные корни парами (числитель, знаменатель); при false во втором — код ошибки
+  std::pair<bool,
+            std::vector<std::pair<long long, long long> > > FindRationalRoots() const;
+
+  // Все комплексные корни одномерного многочлена с кратностями (false, если переменных больше одной)
+  std::pair<bool,
+            std::vector<std::complex<long double> > > FindComplexRoots(long double tol = 1e-12L) const;
+
+  // Интервалы изоляции различных вещественных корней шириной не больше precision
+  std::pair<bool,
+            std::vector<std::pair<long double, long double> > > IsolateRealRoots(long double precision = 1e-9L) const;
+
+  Polynomial operator *(const Polynomial &second) const;
+
+  std::pair<Polynomial, Polynomial> operator /(const Polynomial &second) const;
+
+  // Деление на набор многочленов в порядке этого многочлена (см. ReduceBySet): частное
+  // по каждому делителю и остаток, ни один член которого не делится на их старшие члены
+  std::pair<std::vector<Polynomial>, Polynomial> Reduce(const std::vector<Polynomial> &divisors) const;
+
+
+  std::string GetString() const;
+
+  // Дописывает запись GetString в конец out, не создавая промежуточных строк
+  void Format(std::string &out) const;
+
+  // Начало записи длиной около limit символов (дальше — только число членов); "0" для нулевого
+  std::string Preview(size_t limit) const;
+
+  // Пишет запись в поток кусками по 64 КБ, не собирая её целиком; нулевой многочлен пишется как "0"
+  void Write(std::ostream &out) const;
+
+  EvalPlan Compile() const;
+
+  // k-я производная по переменной ind за один проход: коэффициент умножается на убывающий
+  // факториал e(e-1)...(e-k+1), члены со степенью меньше k выпадают
+  Polynomial derivative(int ind, int k = 1) const;
+
+  // Частные производные по переменным vars за один проход по членам
+  std::vector<Polynomial> Gradient(const std::vector<int> &vars) const;
+
+  // Симметричная матрица вторых производных по vars за один проход по членам
+  std::vector<std::vector<Polynomial> > Hessian(const std::vector<int> &vars) const;
+
+  // Матрица Якоби: строка i — градиент fs[i]; строки считаются параллельно
+  static std::vector<std::vector<Polynomial> > Jacobian(const std::vector<Polynomial> &fs,
+                                                        const std::vector<int> &vars);
+
+  int GetMask() const;
+
+  bool IsEmpty() const;
+
+  // Все коэффициенты целые: такой многочлен можно перемножать точно в BigInt
+  bool HasIntegerCoefficients() const;
+};
+
+// Автомат проверки записи многочлена, таблица строится при компиляции.
+//0 - Начальное состояние
+//1 - После переменной
+//2 - После знака ^ (ожидание степени)
+//3 - В числе степени
+//4 - В целой части коэффициента
+//5 - После точки
+//6 - В дробной части коэффициента
+//7 - После знака +/-
+struct Dfa {
+  signed char next[8][256];
+};
+
+constexpr Dfa BuildDfa() {
+  Dfa dfa{};
+  for (auto &row: dfa.next) {
+    for (auto &x: row) {
+      x = -1;
+    }
+  }
+  for (int c = 'a'; c <= 'z'; c++) {
+    for (int v: {0, 1, 3, 4, 6, 7}) {
+      dfa.next[v][c] = 1;
+    }
+  }
+  for (int c = '0'; c <= '9'; c++) {
+    dfa.next[7][c] = 4;
+    dfa.next[2][c] = 3;
+    dfa.next[3][c] = 3;
+    dfa.next[4][c] = 4;
+    dfa.next[5][c] = 6;
+    dfa.next[6][c] = 6;
+    dfa.next[0][c] = 4;
+  }
+  for (int v: {0, 1, 3, 4, 6}) {
+    dfa.next[v]['-'] = 7;
+    dfa.next[v]['+'] = 7;
+  }
+  dfa.next[1]['^'] = 2;
+  dfa.next[4]['.'] = 5;
+  return dfa;
+}
+
+constexpr Dfa dfa = BuildDfa();
+
+// 10^k; до 10^27 степени представимы в long double точно и берутся из таблицы
+long double Pow10(int k) {
+  static const auto table = [] {
+    std::array<long double, 28> res{};
+    res[0] = 1;
+    for (size_t i = 1; i < res.size(); i++) {
+      res[i] = res[i - 1] * 10;
+    }
+    return res;
+  }();
+  return k < (int) table.size() ? table[k] : std::pow(10.0L, (long double) k);
+}
+
+// Проверка и разбор строки за один проход без рекурсии и копий. Пробелы пропускаются,
+// позиции в сообщениях считаются без пробелов, как и раньше. Ошибки бросаются строкой.
+// Если acc == nullptr, строка только проверяется.
+void ParsePolynomial(std::string_view s, TermAccumulator *acc) {
+  int v = 0;
+  int pos = 0;
+  char prev = 0;
+
+  bool negative = false;
+  long double mantissa = 0;
+  int frac_digits = 0;
+  bool has_digits = false;
+  ExpKey deg;
+  int cur_var = -1;
+  long long cur_pow = 0;
+  // переполнение степени сообщается только после проверки всей строки
+  long long overflow = -1;
+
+  auto flush_var = [&]() {
+    if (cur_var != -1) {
+      long long val = (long long) deg[cur_var] + cur_pow;
+      if (val > ExpKey::MaxDeg) {
+        overflow = (overflow == -1 ? val : overflow);
+      } else {
+        deg[cur_var] = (uint16_t) val;
+      }
+      cur_var = -1;
+    }
+  };
+  auto flush_term = [&]() {
+    flush_var();
+    long double cf = has_digits ? mantissa : 1;
+    if (frac_digits > 0) {
+      cf /= Pow10(frac_digits);
+    }
+    if (acc != nullptr) {
+      acc->Add(deg, negative ? -cf : cf);
+    }
+    mantissa = 0;
+    frac_digits = 0;
+    has_digits = false;
+    deg = ExpKey();
+  };
+
+  for (char c: s) {
+    if (c == ' ') {
+      continue;
+    }
+    int to = dfa.next[v][(unsigned char) c];
+    if (to == -1) {
+      std::string res = "Error in position " + std::to_string(pos + 1) + ", you can not use " + c;
+      res += (pos == 0 ? std::string(" at the beginning") : std::string(" after ") + prev);
+      throw res;
+    }
+    if (to == 7) {
+      if (v != 0) {
+        flush_term();
+      }
+      negative = (c == '-');
+    } else if (to == 4 or to == 6) {
+      mantissa = mantissa * 10 + (c - '0');
+      has_digits = true;
+      frac_digits += (to == 6);
+    } else if (to == 1) {
+      flush_var();
+      cur_var = c - 'a';
+      cur_pow = 1;
+    } else if (to == 2) {
+      cur_pow = 0;
+    } else if (to == 3) {
+      cur_pow = std::min(cur_pow * 10 + (c - '0'), (long long) ExpKey::MaxDeg + 1);
+    }
+    v = to;
+    prev = c;
+    pos++;
+  }
+
+  if (v == 0 or v == 2 or v == 5 or v == 7) {
+    std::string res = "In position " + std::to_string(pos + 1) + ", ";
+    if (v == 5) {
+      res += "There are no numbers after the dot";
+    } else if (v == 2) {
+      res += "There are no numbers after the degree";
+    } else {
+      res += "There is nothing after the sign";
+    }
+    throw res;
+  }
+  flush_term();
+  if (overflow != -1) {
+    throw std::overflow_error("Degree " + std::to_string(overflow) + " is out of range");
+  }
+}
+
+void CheckString(std::string_view s) {
+  ParsePolynomial(s, nullptr);
+}
+
+Polynomial::Polynomial(std::string_view s) {
+  TermAccumulator acc;
+  ParsePolynomial(s, &acc);
+  monos = acc.Extract(true);
+}
+
+long double Monomial::GetY(std::vector<long double> variable) const {
+  long double ans = cf;
+  for (int j = 0; j < LenAlphabet; j++) {
+    if (variable[j] != INF) {
+      ans *= (long double) pow(variable[j], deg[j]);
+    }
+  }
+  return ans;
+}
+
+const ExpKey &Monomial::Deg() const {
+  return deg;
+}
+
+bool Polynomial::CheckCntVars() const {
+  int mask = GetMask();
+  return (mask & (mask - 1)) == 0;
+}
+
+void Polynomial::Normalize() {
+  monos.Normalize(order);
+  plan.reset();
+}
+
+void Polynomial::SetOrder(MonomialOrder new_order) {
+  if (new_order != order) {
+    order = new_order;
+    Normalize();
+  }
+}
+
+const Polynomial &Polynomial::Aligned(const Polynomial &other, Polynomial &buf) const {
+  if (other.order == order) {
+    return other;
+  }
+  buf = other;
+  buf.SetOrder(order);
+  return buf;
+}
+
+std::shared_ptr<const EvalPlan> Polynomial::CachedPlan() const {
+  std::shared_ptr<const EvalPlan> res = std::atomic_load(&plan);
+  if (!res) {
+    // два потока могут построить план одновременно — сохранится любой, оба верны
+    res = std::make_shared<const EvalPlan>(Compile());
+    std::atomic_store(&plan, res);
+  }
+  return res;
+}
+
+long double Polynomial::GetY(const std::vector<long double> &variables) const {
+  return CachedPlan()->Evaluate(variables);
+}
+
+void Polynomial::GetYBatch(const double *const *columns, long long n, double *out) const {
+  CachedPlan()->EvaluateBatch(columns, n, out);
+}
+
+EvalPlan Polynomial::Compile() const {
+  EvalPlan plan;
+  int mask = GetMask();
+  // reg[v] — пары (степень, регистр) переменной v по возрастанию степени
+  std::vector<std::vector<std::pair<int, int> > > reg(LenAlphabet);
+  for (int v = 0; v < LenAlphabet; v++) {
+    if (mask & (1 << v)) {
+      plan.vars.push_back(v);
+    }
+  }
+  plan.reg_count = 1 + (int) plan.vars.size();
+  auto mul = [&plan](int a, int b) {
+    plan.ops.push_back(EvalPlan::Op{plan.reg_count, a, b});
+    return plan.reg_count++;
+  };
+  for (int i = 0; i < (int) plan.vars.size(); i++) {
+    int v = plan.vars[i];
+    std::vector<int> exps;
+    for (auto term: monos) {
+      if (term.deg[v] != 0) {
+        exps.push_back(term.deg[v]);
+      }
+    }
+    std::sort(exps.begin(), exps.end());
+    exps.erase(std::unique(exps.begin(), exps.end()), exps.end());
+    // x^(e_k) = x^(e_{k-1}) * x^(e_k - e_{k-1}), разность собирается из квадратов x^(2^j)
+    std::vector<int> squares(1, 1 + i);
+    int prev_exp = 0;
+    int prev_reg = 0;
+    for (int e: exps) {
+      int diff = e - prev_exp;
+      int cur = -1;
+      for (int j = 0; (diff >> j) != 0; j++) {
+        if (j == (int) squares.size()) {
+          squares.push_back(mul(squares.back(), squares.back()));
+        }
+        if ((diff >> j) & 1) {
+          cur = (cur == -1 ? squares[j] : mul(cur, squares[j]));
+        }
+      }
+      cur = (prev_reg == 0 ? cur : mul(prev_reg, cur));
+      reg[v].push_back(make_pair_custom(e, cur));
+      prev_exp = e;
+      prev_reg = cur;
+    }
+  }
+
+  plan.cfs.reserve(monos.GetSize());
+  plan.shared.reserve(monos.GetSize());
+  plan.factor_begin.reserve(monos.GetSize() + 1);
+  plan.factor_begin.push_back(0);
+  int prev_begin = 0;
+  for (auto term: monos) {
+    int begin = (int) plan.factors.size();
+    for (int v: plan.vars) {
+      if (term.deg[v] != 0) {
+        auto it = std::lower_bound(reg[v].begin(), reg[v].end(), make_pair_custom((int) term.deg[v], -1));
+        plan.factors.push_back(it->second);
+      }
+    }
+    int len = (int) plan.factors.size() - begin;
+    int common = 0;
+    while (common < len and common < begin - prev_begin and
+           plan.factors[prev_begin + common] == plan.factors[begin + common]) {
+      common++;
+    }
+    plan.cfs.push_back(term.cf);
+    plan.shared.push_back(common);
+    plan.factor_begin.push_back((int) plan.factors.size());
+    plan.max_depth = std::max(plan.max_depth, len);
+    prev_begin = begin;
+  }
+  plan.cfs_double.assign(plan.cfs.begin(), plan.cfs.end());
+  return plan;
+}
+
+bool Polynomial::operator ==(const Polynomial &other) const {
+  if (other.order != order) {
+    Polynomial buf;
+    return *this == Aligned(other, buf);
+  }
+  // члены упорядочены и без повторов; пренебрежимо малые пропускаем, как их выбросила бы Normalize
+  int i = 0, j = 0;
+  while (true) {
+    while (i < monos.GetSize() and std::abs(monos.Cf(i)) <= EPS) {
+      i++;
+    }
+    while (j < other.monos.GetSize() and std::abs(other.monos.Cf(j)) <= EPS) {
+      j++;
+    }
+    if (i == monos.GetSize() or j == other.monos.GetSize()) {
+      return i == monos.GetSize() and j == other.monos.GetSize();
+    }
+    if (monos.Deg(i) != other.monos.Deg(j) or std::abs(monos.Cf(i) - other.monos.Cf(j)) > EPS) {
+      return false;
+    }
+    i++;
+    j++;
+  }
+}
+
+Polynomial &Polynomial::operator +=(const Polynomial &other) {
+  Polynomial buf;
+  monos.MergeSorted(Aligned(other, buf).monos, false, order);
+  plan.reset();
+  return *this;
+}
+
+Polynomial &Polynomial::operator -=(const Polynomial &other) {
+  Polynomial buf;
+  monos.MergeSorted(Aligned(other, buf).monos, true, order);
+  plan.reset();
+  return *this;
+}
+
+Polynomial &Polynomial::operator *=(const Polynomial &other) {
+  return *this = *this * other;
+}
+
+Polynomial Polynomial::operator +(const Polynomial &other) const & {
+  Polynomial res;
+  res.order = order;
+  res.monos.Reserve(monos.GetSize() + other.monos.GetSize());
+  res.monos.Append(monos);
+  return std::move(res += other);
+}
+
+Polynomial Polynomial::operator +(const Polynomial &other) && {
+  return std::move(*this += other);
+}
+
+Polynomial Polynomial::operator +(Polynomial &&other) const & {
+  if (other.order != order) {
+    return *this + static_cast<const Polynomial &>(other);
+  }
+  return std::move(other += *this);
+}
+
+Polynomial Polynomial::operator +(Polynomial &&other) && {
+  return std::move(*this += other);
+}
+
+Polynomial Polynomial::operator -(const Polynomial &other) const & {
+  Polynomial res;
+  res.order = order;
+  res.monos.Reserve(monos.GetSize() + other.monos.GetSize());
+  res.monos.Append(monos);
+  return std::move(res -= other);
+}
+
+Polynomial Polynomial::operator -(const Polynomial &other) && {
+  return std::move(*this -= other);
+}
+
+Polynomial Polynomial::operator -(Polynomial &&other) const & {
+  if (other.order != order) {
+    return *this - static_cast<const Polynomial &>(other);
+  }
+  // a - b = -(b - a)
+  other -= *this;
+  for (auto term: other.monos) {
+    term.cf = -term.cf;
+  }
+  return std::move(other);
+}
+
+Polynomial Polynomial::operator -(Polynomial &&other) && {
+  return std::move(*this -= other);
+}
+
+Polynomial Polynomial::operator *(const Polynomial &other) const {
+  int mask = GetMask() | other.GetMask();
+  if (mask != 0 and (mask & (mask - 1)) == 0 and !IsEmpty() and !other.IsEmpty()) {
+    // одна переменная: если оба множителя достаточно плотные, считаем плотным ядром
+    int var = __builtin_ctz(mask);
+    long double len_a = monos.back().deg[var] + 1;
+    long double len_b = other.monos.back().deg[var] + 1;
+    if (monos.GetSize() >= DenseFill * len_a and other.monos.GetSize() >= DenseFill * len_b) {
+      if (len_a + len_b - 2 > ExpKey::MaxDeg) {
+        throw std::overflow_error("Degree is out of range");
+      }
+      return FromDense(DenseMultiply(ToDense(var), other.ToDense(var)), var, order);
+    }
+  }
+  Polynomial buf;
+  Polynomial res;
+  res.order = order;
+  res.monos = HeapMultiply(monos, Aligned(other, buf).monos, Scratch(), order);
+  return res;
+}
+
+std::vector<long double> Polynomial::ToDense(int var) const {
+  std::vector<long double> res(IsEmpty() ? 0 : monos.back().deg[var] + 1, 0.0L);
+  for (auto term: monos) {
+    res[term.deg[var]] += term.cf;
+  }
+  return res;
+}
+
+Polynomial Polynomial::FromDense(const std::vector<long double> &cfs, int var, MonomialOrder order) {
+  Polynomial res;
+  res.order = order;
+  ExpKey deg;
+  for (int k = 0; k < (int) cfs.size(); k++) {
+    if (cfs[k] != 0) {
+      deg[var] = (uint16_t) k;
+      res.monos.PushBack(cfs[k], deg);
+    }
+  }
+  return res;
+}
+
+std::pair<Polynomial, Polynomial> Polynomial::operator /(const Polynomial &other) const {
+  int mask = GetMask() | other.GetMask();
+  if ((mask & (mask - 1)) == 0 and !other.IsEmpty()) {
+    int var = mask ? __builtin_ctz(mask) : 0;
+    auto qr = DenseDivide(ToDense(var), other.ToDense(var));
+    return make_pair_custom(FromDense(qr.first, var, order), FromDense(qr.second, var, order));
+  }
+  // старшие члены берутся в порядке делимого
+  Polynomial buf;
+  const Polynomial &divisor = Aligned(other, buf);
+  Polynomial cur;
+  cur.order = order;
+  cur.monos.Reserve(monos.GetSize() + other.monos.GetSize());
+  cur.monos.Append(monos);
+  // члены частного идут по убыванию, их копит рабочий накопитель и упорядочивает в конце
+  TermAccumulator quotient;
+  while (cur.monos.GetSize() > 0 and divisor.monos.back().deg.Divides(cur.monos.back().deg)) {
+    JobCheckpoint();
+    ExpKey deg = cur.monos.back().deg - divisor.monos.back().deg;
+    long double coef = cur.monos.back().cf / divisor.monos.back().cf;
+    quotient.Add(deg, coef);
+    // старший член уходит точно, остальные: cur -= coef * x^deg * other прямо в буфере cur
+    cur.monos.PopBack();
+    cur.monos.MergeScaled(divisor.monos, -coef, deg, order, divisor.monos.GetSize() - 1);
+  }
+  Polynomial res;
+  res.order = order;
+  res.monos = quotient.Extract(true, order);
+  return make_pair_custom(std::move(res), std::move(cur));
+}
+
+std::pair<std::vector<Polynomial>, Polynomial> Polynomial::Reduce(const std::vector<Polynomial> &divisors) const {
+  std::vector<Polynomial> bufs(divisors.size());
+  std::vector<const TermStore *> stores;
+  for (size_t i = 0; i < divisors.size(); i++) {
+    stores.push_back(&Aligned(divisors[i], bufs[i]).monos);
+  }
+  std::vector<TermStore> quotients;
+  Polynomial rem;
+  rem.order = order;
+  rem.monos = ReduceBySet(monos, stores, order, &quotients);
+  std::vector<Polynomial> res(quotients.size());
+  for (size_t i = 0; i < quotients.size(); i++) {
+    res[i].order = order;
+    res[i].monos = std::move(quotients[i]);
+  }
+  return make_pair_custom(std::move(res), std::move(rem));
+}
+
+int Polynomial::IntegerCoefficients(std::vector<__int128> &a) const {
+  if (!CheckCntVars()) {
+    return 1;
+  }
+  int mask = GetMask();
+  if (mask == 0) {
+    return 0;
+  }
+  int var = __builtin_ctz(mask);
+  a.assign(monos.back().deg[var] + 1, 0);
+  for (auto term: monos) {
+    if (term.cf != std::floor(term.cf) or std::abs(term.cf) >= 9.2e18L) {
+      return 2;
+    }
+    a[term.deg[var]] = (long long) term.cf;
+  }
+  return -1;
+}
+
+std::pair<bool, std::vector<long long> > Polynomial::FindIntegerRoots() const {
+  std::vector<__int128> a;
+  int code = IntegerCoefficients(a);
+  std::vector<long long> res;
+  if (code != -1) {
+    res.push_back(code);
+    return make_pair_custom(false, res);
+  }
+  for (auto &root: ExactRationalRoots(a, true)) {
+    res.push_back(root.first);
+  }
+  return make_pair_custom(true, res);
+}
+
+std::pair<bool, std::vector<std::pair<long long, long long> > > Polynomial::FindRationalRoots() const {
+  std::vector<__int128> a;
+  int code = IntegerCoefficients(a);
+  if (code != -1) {
+    return make_pair_custom(false, std::vector<std::pair<long long, long long> >(1, make_pair_custom(code, 1LL)));
+  }
+  return make_pair_custom(true, ExactRationalRoots(a, false));
+}
+
+std::pair<bool, std::vector<std::complex<long double> > > Polynomial::FindComplexRoots(long double tol) const {
+  if (!CheckCntVars()) {
+    return make_pair_custom(false, std::vector<std::complex<long double> >());
+  }
+  int mask = GetMask();
+  return make_pair_custom(true, AberthRoots(ToDense(mask ? __builtin_ctz(mask) : 0), tol));
+}
+
+std::pair<bool, std::vector<std::pair<long double, long double> > > Polynomial::IsolateRealRoots(
+    long double precision) const {
+  if (!CheckCntVars()) {
+    return make_pair_custom(false, std::vector<std::pair<long double, long double> >());
+  }
+  int mask = GetMask();
+  return make_pair_custom(true, SturmIsolate(ToDense(mask ? __builtin_ctz(mask) : 0), precision));
+}
+
+// Короткие двоичные дроби (целые, половины, четверти, ... до 2^-16) печатаются точно и без to_chars:
+// их точная десятичная запись короче 19 значащих цифр, а значит, она же и кратчайшая. false — не такое число.
+bool AppendShortDyadic(std::string &out, long double x) {
+  long double scaled = x * 65536;
+  if (!(scaled < 9e18L) or scaled != std::floor(scaled)) {
+    return false;
+  }
+  uint64_t n = (uint64_t) scaled;
+  int k = 16;
+  while (k > 0 and n % 2 == 0) {
+    n /= 2;
+    k--;
+  }
+  uint64_t pow5 = 1;
+  for (int i = 0; i < k; i++) {
+    pow5 *= 5;
+  }
+  if (n > 1000000000000000000ull / pow5) {
+    return false;
+  }
+  // n / 2^k = n * 5^k / 10^k
+  char buf[24];
+  char *end = std::to_chars(buf, buf + sizeof(buf), n * pow5).ptr;
+  int len = (int) (end - buf);
+  if (k == 0) {
+    out.append(buf, end);
+  } else if (len > k) {
+    out.append(buf, len - k);
+    out += '.';
+    out.append(end - k, end);
+  } else {
+    out += "0.";
+    out.append(k - len, '0');
+    out.append(buf, end);
+  }
+  return true;
+}
+
+// Кратчайшая запись неотрицательного числа без экспоненты, которая читается обратно в то же число
+template<typename F>
+void AppendNumber(std::string &out, F x) {
+  if (AppendShortDyadic(out, x)) {
+    return;
+  }
+  char buf[64];
+  auto res = std::to_chars(buf, buf + sizeof(buf), x, std::chars_format::fixed);
+  if (res.ec == std::errc()) {
+    out.append(buf, res.ptr);
+  } else {
+    // очень большие и очень маленькие числа без экспоненты занимают тысячи знаков
+    size_t old = out.size();
+    out.resize(old + 5000);
+    res = std::to_chars(&out[old], &out[old] + 5000, x, std::chars_format::fixed);
+    out.resize(res.ptr - out.data());
+  }
+}
+
+// Переменные члена со степенями ("ab^2"); берутся по маске, нулевые степени не просматриваются
+void AppendVariables(std::string &out, const ExpKey &deg) {
+  for (int mask = deg.Mask(); mask != 0; mask &= mask - 1) {
+    int j = __builtin_ctz(mask);
+    out += (char) (j + 'a');
+    if (deg[j] != 1) {
+      char buf[8];
+      out += '^';
+      out.append(buf, std::to_chars(buf, buf + sizeof(buf), deg[j]).ptr);
+    }
+  }
+}
+
+// Дописывает один член в записи GetString: знак, коэффициент (если он не ±1 или член свободный),
+// затем переменные со степенями.
+void AppendTerm(std::string &out, long double cf, const ExpKey &deg, bool first) {
+  if (cf < 0) {
+    out += "- ";
+  } else if (!first) {
+    out += "+ ";
+  }
+  if ((cf != 1 and cf != -1) or deg.Mask() == 0) {
+    AppendNumber(out, std::abs(cf));
+  }
+  AppendVariables(out, deg);
+  out += ' ';
+}
+
+void Polynomial::Format(std::string &out) const {
+  for (int i = 0; i < monos.GetSize(); i++) {
+    AppendTerm(out, monos.Cf(i), monos.Deg(i), i == 0);
+  }
+}
+
+void Polynomial::Write(std::ostream &out) const {
+  static thread_local std::string chunk;
+  chunk.clear();
+  if (monos.Empty()) {
+    chunk += '0';
+  }
+  for (int i = 0; i < monos.GetSize(); i++) {
+    AppendTerm(chunk, monos.Cf(i), monos.Deg(i), i == 0);
+    if (chunk.size() >= (1 << 16)) {
+      out.write(chunk.data(), (std::streamsize) chunk.size());
+      chunk.clear();
+    }
+  }
+  out.write(chunk.data(), (std::streamsize) chunk.size());
+}
+
+std::string Polynomial::Preview(size_t limit) const {
+  if (monos.Empty()) {
+    return "0";
+  }
+  std::string res;
+  for (int i = 0; i < monos.GetSize(); i++) {
+    if (res.size() >= limit) {
+      res += "... (" + std::to_string(monos.GetSize()) + " terms)";
+      break;
+    }
+    AppendTerm(res, monos.Cf(i), monos.Deg(i), i == 0);
+  }
+  return res;
+}
+
+std::string Polynomial::GetString() const {
+  std::string res;
+  Format(res);
+  return res;
+}
+
+int Polynomial::GetMask() const {
+  int mask = 0;
+  for (auto term: monos) {
+    mask |= term.deg.Mask();
+  }
+  return mask;
+}
+
+bool Polynomial::IsEmpty() const {
+  return monos.Empty();
+}
+
+bool Polynomial::HasIntegerCoefficients() const {
+  for (auto term: monos) {
+    if (!std::isfinite(term.cf) or term.cf != std::floor(term.cf)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Номера переменных в маску; бросает std::domain_error для номера вне алфавита
+int VariablesMask(const std::vector<int> &vars) {
+  int mask = 0;
+  for (int v: vars) {
+    if (v < 0 or v >= LenAlphabet) {
+      throw std::domain_error("Variable index " + std::to_string(v) + " is out of range");
+    }
+    mask |= 1 << v;
+  }
+  return mask;
+}
+
+Polynomial Polynomial::derivative(int ind, int k) const {
+  VariablesMask({ind});
+  if (k < 0) {
+    throw std::domain_error("Derivative order must be non-negative");
+  }
+  // деление оставшихся членов на x^k сохраняет любой мономиальный порядок,
+  // а коэффициент, умноженный на целое >= 1, остаётся больше EPS — пересортировка не нужна
+  Polynomial res;
+  res.order = order;
+  res.monos.Reserve(monos.GetSize());
+  // убывающие факториалы по степеням, 0 — ещё не посчитан
+  std::pmr::vector<long double> falling(Scratch());
+  for (auto term: monos) {
+    int e = term.deg[ind];
+    if (e < k) {
+      continue;
+    }
+    if ((int) falling.size() <= e) {
+      falling.resize(e + 1, 0.0L);
+    }
+    if (falling[e] == 0) {
+      long double f = 1;
+      for (int i = 0; i < k; i++) {
+        f *= e - i;
+      }
+      falling[e] = f;
+    }
+    long double cf = term.cf * falling[e];
+    if (!std::isfinite(cf)) {
+      throw std::overflow_error("Coefficient is out of range");
+    }
+    res.monos.PushBack(cf, term.deg);
+    res.monos.back().deg[ind] = (uint16_t) (e - k);
+  }
+  return res;
+}
+
+std::vector<Polynomial> Polynomial::Gradient(const std::vector<int> &vars) const {
+  int wanted = VariablesMask(vars);
+  std::vector<Polynomial> res(vars.size());
+  // куда идёт производная по переменной; повторы в vars досчитываются копией
+  int slot[LenAlphabet];
+  std::fill(slot, slot + LenAlphabet, -1);
+  for (int i = 0; i < (int) vars.size(); i++) {
+    res[i].order = order;
+    if (slot[vars[i]] == -1) {
+      slot[vars[i]] = i;
+    }
+  }
+  // по маскам членов сначала считаются размеры, чтобы выходы не переезжали при росте
+  std::pmr::vector<int> masks(monos.GetSize(), Scratch());
+  int count[LenAlphabet] = {};
+  for (int t = 0; t < monos.GetSize(); t++) {
+    masks[t] = monos.Deg(t).Mask() & wanted;
+    for (int bits = masks[t]; bits; bits &= bits - 1) {
+      count[__builtin_ctz(bits)]++;
+    }
+  }
+  for (int v = 0; v < LenAlphabet; v++) {
+    if (slot[v] != -1) {
+      res[slot[v]].monos.Reserve(count[v]);
+    }
+  }
+  for (int t = 0; t < monos.GetSize(); t++) {
+    auto term = monos[t];
+    for (int bits = masks[t]; bits; bits &= bits - 1) {
+      int v = __builtin_ctz(bits);
+      TermStore &out = res[slot[v]].monos;
+      out.PushBack(term.cf * term.deg[v], term.deg);
+      out.back().deg[v]--;
+    }
+  }
+  for (int i = 0; i < (int) vars.size(); i++) {
+    if (slot[vars[i]] != i) {
+      res[i] = res[slot[vars[i]]];
+    }
+  }
+  return res;
+}
+
+std::vector<std::vector<Polynomial> > Polynomial::Hessian(const std::vector<int> &vars) const {
+  int wanted = VariablesMask(vars);
+  int n = (int) vars.size();
+  std::vector<std::vector<Polynomial> > res(n, std::vector<Polynomial>(n));
+  int slot[LenAlphabet];
+  std::fill(slot, slot + LenAlphabet, -1);
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      res[i][j].order = order;
+    }
+    if (slot[vars[i]] == -1) {
+      slot[vars[i]] = i;
+    }
+  }
+  // считается верхний треугольник по первым вхождениям переменных: член отдаёт слагаемое
+  // в (u, v) для каждой пары u <= v из своих переменных, степень по u уменьшается один раз на всю строку.
+  // Размеры клеток считаются заранее по маскам членов (в (u, u) — только члены со степенью u от 2).
+  std::pmr::vector<int> masks(monos.GetSize(), Scratch());
+  std::vector<int> count(LenAlphabet * LenAlphabet, 0);
+  for (int t = 0; t < monos.GetSize(); t++) {
+    masks[t] = monos.Deg(t).Mask() & wanted;
+    for (int bits = masks[t]; bits; bits &= bits - 1) {
+      int u = __builtin_ctz(bits);
+      count[u * LenAlphabet + u] += monos.Deg(t)[u] >= 2;
+      for (int rest = bits & (bits - 1); rest; rest &= rest - 1) {
+        count[u * LenAlphabet + __builtin_ctz(rest)]++;
+      }
+    }
+  }
+  for (int u = 0; u < LenAlphabet; u++) {
+    for (int v = u; v < LenAlphabet; v++) {
+      if (slot[u] != -1 and slot[v] != -1) {
+        res[std::min(slot[u], slot[v])][std::max(slot[u], slot[v])].monos.Reserve(count[u * LenAlphabet + v]);
+      }
+    }
+  }
+  for (int t = 0; t < monos.GetSize(); t++) {
+    auto term = monos[t];
+    for (int bits = masks[t]; bits; bits &= bits - 1) {
+      int u = __builtin_ctz(bits);
+      ExpKey du = term.deg;
+      du[u]--;
+      long double cu = term.cf * term.deg[u];
+      for (int rest = bits; rest; rest &= rest - 1) {
+        int v = __builtin_ctz(rest);
+        if (du[v] == 0) {
+          continue;
+        }
+        int a = std::min(slot[u], slot[v]), b = std::max(slot[u], slot[v]);
+        TermStore &out = res[a][b].monos;
+        out.PushBack(cu * du[v], du);
+        out.back().deg[v]--;
+      }
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      int a = std::min(slot[vars[i]], slot[vars[j]]), b = std::max(slot[vars[i]], slot[vars[j]]);
+      if (a != i or b != j) {
+        res[i][j] = res[a][b];
+      }
+    }
+  }
+  return res;
+}
+
+std::vector<std::vector<Polynomial> > Polynomial::Jacobian(const std::vector<Polynomial> &fs,
+                                                           const std::vector<int> &vars) {
+  VariablesMask(vars);
+  std::vector<std::vector<Polynomial> > res(fs.size());
+  DefaultPool().ParallelFor((long long) fs.size(), 1, [&](long long begin, long long end) {
+    for (long long i = begin; i < end; i++) {
+      res[i] = fs[i].Gradient(vars);
+    }
+  });
+  return res;
+}
+
+void Ring<long double>::Format(std::string &out, long double x) {
+  if (x < 0) {
+    out += '-';
+  }
+  AppendNumber(out, std::abs(x));
+}
+
+void Ring<double>::Format(std::string &out, double x) {
+  if (x < 0) {
+    out += '-';
+  }
+  AppendNumber(out, std::abs(x));
+}
+
+// Целое произвольной длины: знак и модуль по основанию 2^32, младшие разряды первыми
+class BigInt {
+  std::vector<uint32_t> mag;
+  bool neg = false;
+
+  void Trim() {
+    while (!mag.empty() and mag.back() == 0) {
+      mag.pop_back();
+    }
+    if (mag.empty()) {
+      neg = false;
+    }
+  }
+
+  static int CompareMag(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+    if (a.size() != b.size()) {
+      return a.size() < b.size() ? -1 : 1;
+    }
+    for (size_t i = a.size(); i-- > 0;) {
+      if (a[i] != b[i]) {
+        return a[i] < b[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  static void AddMag(std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+    if (a.size() < b.size()) {
+      a.resize(b.size(), 0);
+    }
+    uint64_t carry = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+      carry += (uint64_t) a[i] + (i < b.size() ? b[i] : 0);
+      a[i] = (uint32_t) carry;
+      carry >>= 32;
+    }
+    if (carry != 0) {
+      a.push_back((uint32_t) carry);
+    }
+  }
+
+  // a -= b при |a| >= |b|
+  static void SubMag(std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+      int64_t cur = (int64_t) a[i] - (i < b.size() ? b[i] : 0) - borrow;
+      borrow = cur < 0;
+      a[i] = (uint32_t) (cur + (borrow << 32));
+    }
+  }
+
+  // a = a * mul + add
+  static void MulAddSmall(std::vector<uint32_t> &a, uint32_t mul, uint32_t add) {
+    uint64_t carry = add;
+    for (auto &x: a) {
+      carry += (uint64_t) x * mul;
+      x = (uint32_t) carry;
+      carry >>= 32;
+    }
+    if (carry != 0) {
+      a.push_back((uint32_t) carry);
+    }
+  }
+
+  // a /= d, возвращает остаток
+  static uint32_t DivSmall(std::vector<uint32_t> &a, uint32_t d) {
+    uint64_t rem = 0;
+    for (size_t i = a.size(); i-- > 0;) {
+      uint64_t cur = (rem << 32) | a[i];
+      a[i] = (uint32_t) (cur / d);
+      rem = cur % d;
+    }
+    return (uint32_t) rem;
+  }
+
+  // Деление модулей столбиком (алгоритм D Кнута)
+  static void DivModMag(const std::vector<uint32_t> &u, const std::vector<uint32_t> &v,
+                        std::vector<uint32_t> &q, std::vector<uint32_t> &r) {
+    if (CompareMag(u, v) < 0) {
+      q.clear();
+      r = u;
+      return;
+    }
+    if (v.size() == 1) {
+      q = u;
+      r.assign(1, DivSmall(q, v[0]));
+      return;
+    }
+    size_t n = v.size(), m = u.size() - v.size();
+    int s = __builtin_clz(v.back());
+    std::vector<uint32_t> vn(n), un(u.size() + 1);
+    for (size_t i = n - 1; i > 0; i--) {
+      vn[i] = (v[i] << s) | (s ? (uint32_t) ((uint64_t) v[i - 1] >> (32 - s)) : 0);
+    }
+    vn[0] = v[0] << s;
+    un[u.size()] = s ? (uint32_t) ((uint64_t) u.back() >> (32 - s)) : 0;
+    for (size_t i = u.size() - 1; i > 0; i--) {
+      un[i] = (u[i] << s) | (s ? (uint32_t) ((uint64_t) u[i - 1] >> (32 - s)) : 0);
+    }
+    un[0] = u[0] << s;
+    q.assign(m + 1, 0);
+    const uint64_t base = 1ull << 32;
+    for (size_t j = m + 1; j-- > 0;) {
+      uint64_t num = ((uint64_t) un[j + n] << 32) | un[j + n - 1];
+      uint64_t qhat = num / vn[n - 1];
+      uint64_t rhat = num % vn[n - 1];
+      while (qhat >= base or qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+        qhat--;
+        rhat += vn[n - 1];
+        if (rhat >= base) {
+          break;
+        }
+      }
+      int64_t borrow = 0, t;
+      for (size_t i = 0; i < n; i++) {
+        uint64_t p = qhat * vn[i];
+        t = (int64_t) un[i + j] - borrow - (int64_t) (p & 0xFFFFFFFFu);
+        un[i + j] = (uint32_t) t;
+        borrow = (int64_t) (p >> 32) - (t >> 32);
+      }
+      t = (int64_t) un[j + n] - borrow;
+      un[j + n] = (uint32_t) t;
+      q[j] = (uint32_t) qhat;
+      if (t < 0) {
+        q[j]--;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; i++) {
+          carry += (uint64_t) un[i + j] + vn[i];
+          un[i + j] = (uint32_t) carry;
+          carry >>= 32;
+        }
+        un[j + n] += (uint32_t) carry;
+      }
+    }
+    r.assign(n, 0);
+    for (size_t i = 0; i < n; i++) {
+      r[i] = (un[i] >> s) | (s ? (uint32_t) ((uint64_t) un[i + 1] << (32 - s)) : 0);
+    }
+  }
+
+ public:
+  BigInt() = default;
+
+  BigInt(long long x) : BigInt((__int128) x) {
+  }
+
+  BigInt(__int128 x) {
+    neg = x < 0;
+    unsigned __int128 m = neg ? -(unsigned __int128) x : (unsigned __int128) x;
+    while (m != 0) {
+      mag.push_back((uint32_t) m);
+      m >>= 32;
+    }
+  }
+
+  // Целое значение x; бросает std::domain_error для дробных и бесконечных
+  static BigInt FromLongDouble(long double x) {
+    if (!std::isfinite(x) or x != std::floor(x)) {
+      throw std::domain_error("Coefficient is not an integer");
+    }
+    BigInt res;
+    res.neg = x < 0;
+    x = std::abs(x);
+    int e;
+    long double frac = std::frexp(x, &e);
+    uint64_t m = (uint64_t) std::ldexp(frac, 64);
+    res.mag = {(uint32_t) m, (uint32_t) (m >> 32)};
+    res.Trim();
+    return res.Shifted(e - 64);
+  }
+
+  // Десятичная запись без знака
+  static BigInt FromDecimal(std::string_view digits) {
+    BigInt res;
+    for (char c: digits) {
+      MulAddSmall(res.mag, 10, (uint32_t) (c - '0'));
+    }
+    res.Trim();
+    return res;
+  }
+
+  // Умножение (bits > 0) или деление нацело (bits < 0) модуля на 2^|bits|
+  BigInt Shifted(int bits) const {
+    BigInt res = *this;
+    if (bits >= 0) {
+      res.mag.insert(res.mag.begin(), bits / 32, 0);
+      if (bits % 32 != 0) {
+        res.mag.push_back(0);
+        for (size_t i = res.mag.size() - 1; i > (size_t) bits / 32; i--) {
+          res.mag[i] = (res.mag[i] << (bits % 32)) | (res.mag[i - 1] >> (32 - bits % 32));
+        }
+        res.mag[bits / 32] <<= bits % 32;
+      }
+    } else {
+      bits = -bits;
+      if ((size_t) bits / 32 >= res.mag.size()) {
+        return BigInt();
+      }
+      res.mag.erase(res.mag.begin(), res.mag.begin() + bits / 32);
+      if (bits % 32 != 0) {
+        for (size_t i = 0; i < res.mag.size(); i++) {
+          res.mag[i] = (res.mag[i] >> (bits % 32)) |
+                       (i + 1 < res.mag.size() ? res.mag[i + 1] << (32 - bits % 32) : 0);
+        }
+      }
+    }
+    res.Trim();
+    return res;
+  }
+
+  bool IsZero() const {
+    return mag.empty();
+  }
+
+  bool Negative() const {
+    return neg;
+  }
+
+  // Число значащих бит модуля
+  int BitLength() const {
+    return mag.empty() ? 0 : (int) mag.size() * 32 - __builtin_clz(mag.back());
+  }
+
+  // *this = *this * mul + add для неотрицательных
+  void MulAdd(uint32_t mul, uint32_t add) {
+    MulAddSmall(mag, mul, add);
+    Trim();
+  }
+
+  // Значение в out, если оно помещается в long long
+  bool ToInt64(long long &out) const {
+    if (mag.size() > 2) {
+      return false;
+    }
+    uint64_t m = mag.empty() ? 0 : mag[0] | (mag.size() > 1 ? (uint64_t) mag[1] << 32 : 0);
+    if (m > (uint64_t) INT64_MAX + neg) {
+      return false;
+    }
+    out = neg ? (long long) (0 - m) : (long long) m;
+    return true;
+  }
+
+  BigInt operator -() const {
+    BigInt res = *this;
+    res.neg = !neg and !mag.empty();
+    return res;
+  }
+
+  BigInt operator +(const BigInt &other) const {
+    BigInt res = *this;
+    if (neg == other.neg) {
+      AddMag(res.mag, other.mag);
+    } else if (CompareMag(mag, other.mag) >= 0) {
+      SubMag(res.mag, other.mag);
+    } else {
+      res.mag = other.mag;
+      res.neg = other.neg;
+      SubMag(res.mag, mag);
+    }
+    res.Trim();
+    return res;
+  }
+
+  BigInt operator -(const BigInt &other) const {
+    return *this + (-other);
+  }
+
+  BigInt &operator +=(const BigInt &other) {
+    return *this = *this + other;
+  }
+
+  BigInt operator *(const BigInt &other) const {
+    BigInt res;
+    if (mag.empty() or other.mag.empty()) {
+      return res;
+    }
+    res.mag.assign(mag.size() + other.mag.size(), 0);
+    for (size_t i = 0; i < mag.size(); i++) {
+      uint64_t carry = 0;
+      for (size_t j = 0; j < other.mag.size(); j++) {
+        carry += (uint64_t) mag[i] * other.mag[j] + res.mag[i + j];
+        res.mag[i + j] = (uint32_t) carry;
+        carry >>= 32;
+      }
+      res.mag[i + other.mag.size()] = (uint32_t) carry;
+    }
+    res.neg = neg != other.neg;
+    res.Trim();
+    return res;
+  }
+
+  // Частное округляется к нулю, остаток имеет знак делимого
+  static void DivMod(const BigInt &a, const BigInt &b, BigInt &q, BigInt &r) {
+    if (b.IsZero()) {
+      throw std::domain_error("Division by zero");
+    }
+    DivModMag(a.mag, b.mag, q.mag, r.mag);
+    q.neg = a.neg != b.neg;
+    r.neg = a.neg;
+    q.Trim();
+    r.Trim();
+  }
+
+  BigInt operator /(const BigInt &other) const {
+    BigInt q, r;
+    DivMod(*this, other, q, r);
+    return q;
+  }
+
+  BigInt operator %(const BigInt &other) const {
+    BigInt q, r;
+    DivMod(*this, other, q, r);
+    return r;
+  }
+
+  // Неотрицательный остаток от деления на m
+  uint32_t Mod(uint32_t m) const {
+    uint64_t rem = 0;
+    for (size_t i = mag.size(); i-- > 0;) {
+      rem = ((rem << 32) | mag[i]) % m;
+    }
+    return neg and rem != 0 ? m - (uint32_t) rem : (uint32_t) rem;
+  }
+
+  bool operator ==(const BigInt &other) const {
+    return neg == other.neg and mag == other.mag;
+  }
+
+  bool operator !=(const BigInt &other) const {
+    return !(*this == other);
+  }
+
+  bool operator <(const BigInt &other) const {
+    if (neg != other.neg) {
+      return neg;
+    }
+    int cmp = CompareMag(mag, other.mag);
+    return neg ? cmp > 0 : cmp < 0;
+  }
+
+  static BigInt Gcd(BigInt a, BigInt b) {
+    a.neg = b.neg = false;
+    auto low = [](const BigInt &x) {
+      return (x.mag.size() > 0 ? x.mag[0] : 0) | (x.mag.size() > 1 ? (uint64_t) x.mag[1] << 32 : 0);
+    };
+    while (!b.IsZero()) {
+      // остаток быстро становится машинным словом, дальше делить длинно незачем
+      if (a.mag.size() <= 2 and b.mag.size() <= 2) {
+        return BigInt((__int128) std::gcd(low(a), low(b)));
+      }
+      BigInt r = a % b;
+      a = std::move(b);
+      b = std::move(r);
+    }
+    return a;
+  }
+
+  long double ToLongDouble() const {
+    long double res = 0;
+    for (size_t i = mag.size(); i-- > 0;) {
+      res = res * 4294967296.0L + mag[i];
+    }
+    return neg ? -res : res;
+  }
+
+  std::string ToString() const {
+    if (mag.empty()) {
+      return "0";
+    }
+    std::vector<uint32_t> cur = mag;
+    std::vector<uint32_t> parts;
+    while (!cur.empty()) {
+      parts.push_back(DivSmall(cur, 1000000000));
+      while (!cur.empty() and cur.back() == 0) {
+        cur.pop_back();
+      }
+    }
+    std::string res = neg ? "-" : "";
+    res += std::to_string(parts.back());
+    for (size_t i = parts.size() - 1; i-- > 0;) {
+      std::string part = std::to_string(parts[i]);
+      res += std::string(9 - part.size(), '0') + part;
+    }
+    return res;
+  }
+};
+
+// Рациональное число: несократимая дробь со знаменателем больше нуля
+class Rational {
+  BigInt num;
+  BigInt den = BigInt(1ll);
+
+  void Reduce() {
+    if (den.IsZero()) {
+      throw std::domain_error("Division by zero");
+    }
+    if (den.Negative()) {
+      num = -num;
+      den = -den;
+    }
+    BigInt g = BigInt::Gcd(num, den);
+    if (g != BigInt(1ll) and !g.IsZero()) {
+      num = num / g;
+      den = den / g;
+    }
+  }
+
+ public:
+  Rational() = default;
+
+  Rational(long long x) : num(x) {
+  }
+
+  Rational(BigInt num, BigInt den) : num(std::move(num)), den(std::move(den)) {
+    Reduce();
+  }
+
+  // Точное значение кратчайшей десятичной записи x: 0.1 становится 1/10, а не двоичной дробью
+  static Rational FromLongDouble(long double x) {
+    if (!std::isfinite(x)) {
+      throw std::domain_error("Coefficient is not finite");
+    }
+    std::string s;
+    AppendNumber(s, std::abs(x));
+    size_t dot = s.find('.');
+    std::string digits = s;
+    size_t frac = 0;
+    if (dot != std::string::npos) {
+      digits.erase(dot, 1);
+      frac = s.size() - dot - 1;
+    }
+    BigInt n = BigInt::FromDecimal(digits);
+    return Rational(x < 0 ? -n : n, BigInt::FromDecimal("1" + std::string(frac, '0')));
+  }
+
+  const BigInt &Num() const {
+    return num;
+  }
+
+  const BigInt &Den() const {
+    return den;
+  }
+
+  Rational operator -() const {
+    Rational res = *this;
+    res.num = -num;
+    return res;
+  }
+
+  Rational operator +(const Rational &other) const {
+    return Rational(num * other.den + other.num * den, den * other.den);
+  }
+
+  Rational operator -(const Rational &other) const {
+    return Rational(num * other.den - other.num * den, den * other.den);
+  }
+
+  Rational operator *(const Rational &other) const {
+    return Rational(num * other.num, den * other.den);
+  }
+
+  Rational operator /(const Rational &other) const {
+    return Rational(num * other.den, den * other.num);
+  }
+
+  Rational &operator +=(const Rational &other) {
+    return *this = *this + other;
+  }
+
+  bool operator ==(const Rational &other) const {
+    return num == other.num and den == other.den;
+  }
+
+  bool operator !=(const Rational &other) const {
+    return !(*this == other);
+  }
+
+  long double ToLongDouble() const {
+    return num.ToLongDouble() / den.ToLongDouble();
+  }
+
+  std::string ToString() const {
+    return den == BigInt(1ll) ? num.ToString() : num.ToString() + "/" + den.ToString();
+  }
+};
+
+// Целое с проверкой переполнения: выход за диапазон T бросает std::overflow_error
+template<typename T>
+class Checked {
+  T v = 0;
+
+  [[noreturn]] static void Overflow() {
+    throw std::overflow_error("Integer coefficient overflow");
+  }
+
+ public:
+  Checked() = default;
+
+  Checked(T v) : v(v) {
+  }
+
+  T Value() const {
+    return v;
+  }
+
+  Checked operator -() const {
+    T res;
+    if (__builtin_sub_overflow((T) 0, v, &res)) {
+      Overflow();
+    }
+    return res;
+  }
+
+  Checked operator +(Checked other) const {
+    T res;
+    if (__builtin_add_overflow(v, other.v, &res)) {
+      Overflow();
+    }
+    return res;
+  }
+
+  Checked operator -(Checked other) const {
+    T res;
+    if (__builtin_sub_overflow(v, other.v, &res)) {
+      Overflow();
+    }
+    return res;
+  }
+
+  Checked operator *(Checked other) const {
+    T res;
+    if (__builtin_mul_overflow(v, other.v, &res)) {
+      Overflow();
+    }
+    return res;
+  }
+
+  Checked &operator +=(Checked other) {
+    return *this = *this + other;
+  }
+
+  bool operator ==(Checked other) const {
+    return v == other.v;
+  }
+
+  bool operator !=(Checked other) const {
+    return v != other.v;
+  }
+};
+
+// Обратный к нечётному p по модулю 2^32 (итерации Ньютона)
+constexpr uint32_t MontgomeryInverse(uint32_t p) {
+  uint32_t inv = p;
+  for (int i = 0; i < 5; i++) {
+    inv *= 2 - p * inv;
+  }
+  return inv;
+}
+
+// Вычет по простому модулю P < 2^30. Хранится в форме Монтгомери (x * 2^32 mod P),
+// поэтому умножение обходится без деления: одно 64-битное произведение и сдвиг.
+template<uint32_t P>
+class Zp {
+  static_assert(P % 2 == 1 and P < (1u << 30), "Montgomery form needs an odd modulus below 2^30");
+  static constexpr uint32_t NegInv = -MontgomeryInverse(P);
+  // 2^64 mod P — множитель для перевода в форму Монтгомери
+  static constexpr uint32_t R2 = (uint32_t) (((unsigned __int128) 1 << 64) % P);
+
+  uint32_t v = 0;
+
+  static uint32_t Reduce(uint64_t t) {
+    uint32_t m = (uint32_t) t * NegInv;
+    uint32_t u = (uint32_t) ((t + (uint64_t) m * P) >> 32);
+    return u >= P ? u - P : u;
+  }
+
+ public:
+  static constexpr uint32_t Modulus = P;
+
+  Zp() = default;
+
+  Zp(long long x) {
+    long long r = x % (long long) P;
+    v = Reduce((uint64_t) (r < 0 ? r + P : r) * R2);
+  }
+
+  uint32_t Value() const {
+    return Reduce(v);
+  }
+
+  Zp operator -() const {
+    Zp res;
+    res.v = v == 0 ? 0 : P - v;
+    return res;
+  }
+
+  Zp operator +(Zp other) const {
+    Zp res;
+    res.v = v + other.v >= P ? v + other.v - P : v + other.v;
+    return res;
+  }
+
+  Zp operator -(Zp other) const {
+    Zp res;
+    res.v = v >= other.v ? v - other.v : v + P - other.v;
+    return res;
+  }
+
+  Zp operator *(Zp other) const {
+    Zp res;
+    res.v = Reduce((uint64_t) v * other.v);
+    return res;
+  }
+
+  Zp &operator +=(Zp other) {
+    return *this = *this + other;
+  }
+
+  Zp operator /(Zp other) const {
+    return *this * other.Inverse();
+  }
+
+  Zp Pow(uint64_t e) const {
+    Zp res(1), base = *this;
+    for (; e > 0; e >>= 1) {
+      if (e & 1) {
+        res = res * base;
+      }
+      base = base * base;
+    }
+    return res;
+  }
+
+  Zp Inverse() const {
+    if (v == 0) {
+      throw std::domain_error("Division by zero");
+    }
+    return Pow(P - 2);
+  }
+
+  bool operator ==(Zp other) const {
+    return v == other.v;
+  }
+
+  bool operator !=(Zp other) const {
+    return v != other.v;
+  }
+};
+
+// Простое 119 * 2^23 + 1 с корнями из единицы степени 2^23
+using Z998 = Zp<998244353>;
+
+template<typename T>
+struct Ring<Checked<T> > {
+  static bool IsZero(Checked<T> x) {
+    return x.Value() == 0;
+  }
+
+  // Бросает std::domain_error для дробных и не помещающихся в T
+  static Checked<T> FromLongDouble(long double x) {
+    if (!std::isfinite(x) or x != std::floor(x) or std::abs(x) >= std::ldexp(1.0L, sizeof(T) * 8 - 1)) {
+      throw std::domain_error("Coefficient is not a representable integer");
+    }
+    return (T) x;
+  }
+
+  static long double ToLongDouble(Checked<T> x) {
+    return (long double) x.Value();
+  }
+
+  static void Format(std::string &out, Checked<T> x) {
+    out += BigInt((__int128) x.Value()).ToString();
+  }
+};
+
+template<uint32_t P>
+struct Ring<Zp<P> > {
+  static bool IsZero(Zp<P> x) {
+    return x == Zp<P>();
+  }
+
+  // Дробь из десятичной записи переводится в поле: 0.5 становится обратным к 2
+  static Zp<P> FromLongDouble(long double x) {
+    Rational r = Rational::FromLongDouble(x);
+    Zp<P> den(r.Den().Mod(P));
+    if (den == Zp<P>()) {
+      throw std::domain_error("Coefficient denominator is divisible by the modulus");
+    }
+    return Zp<P>(r.Num().Mod(P)) * den.Inverse();
+  }
+
+  static long double ToLongDouble(Zp<P> x) {
+    return x.Value();
+  }
+
+  static void Format(std::string &out, Zp<P> x) {
+    out += std::to_string(x.Value());
+  }
+};
+
+template<>
+struct Ring<Rational> {
+  static bool IsZero(const Rational &x) {
+    return x.Num().IsZero();
+  }
+
+  static Rational FromLongDouble(long double x) {
+    return Rational::FromLongDouble(x);
+  }
+
+  static long double ToLongDouble(const Rational &x) {
+    return x.ToLongDouble();
+  }
+
+  // Дробь берётся в скобки, чтобы не слипалась с переменными: (3/4)x
+  static void Format(std::string &out, const Rational &x) {
+    if (x.Den() == BigInt(1ll)) {
+      out += x.Num().ToString();
+    } else {
+      out += "(" + x.ToString() + ")";
+    }
+  }
+};
+
+template<>
+struct Ring<BigInt> {
+  static bool IsZero(const BigInt &x) {
+    return x.IsZero();
+  }
+
+  static BigInt FromLongDouble(long double x) {
+    return BigInt::FromLongDouble(x);
+  }
+
+  static long double ToLongDouble(const BigInt &x) {
+    return x.ToLongDouble();
+  }
+
+  static void Format(std::string &out, const BigInt &x) {
+    out += x.ToString();
+  }
+};
+
+// Школьное умножение плотных массивов double; внутренний цикл — axpy, который векторизуется
+MULTI_ISA
+void SchoolbookMultiplyDouble(const double *a, int n, const double *b, int m, double *res) {
+  for (int i = 0; i < n; i++) {
+    double x = a[i];
+    double *r = res + i;
+    for (int j = 0; j < m; j++) {
+      r[j] += x * b[j];
+    }
+  }
+}
+
+// Плотное одномерное умножение над кольцом. По умолчанию — школьное в арифметике кольца
+// (для Zp это умножения Монтгомери, для точных колец — без потерь и без EPS).
+template<typename R>
+std::vector<R> DenseProduct(const std::vector<R> &a, const std::vector<R> &b) {
+  std::vector<R> res(a.size() + b.size() - 1);
+  for (size_t i = 0; i < a.size(); i++) {
+    if (Ring<R>::IsZero(a[i])) {
+      continue;
+    }
+    JobCheckpoint((double) i / a.size());
+    for (size_t j = 0; j < b.size(); j++) {
+      res[i + j] += a[i] * b[j];
+    }
+  }
+  return res;
+}
+
+template<>
+std::vector<long double> DenseProduct(const std::vector<long double> &a, const std::vector<long double> &b) {
+  return DenseMultiply(a, b);
+}
+
+// Короткие — векторизованным школьным, длинные — через Карацубу/БПФ в long double
+template<>
+std::vector<double> DenseProduct(const std::vector<double> &a, const std::vector<double> &b) {
+  if ((int) std::min(a.size(), b.size()) <= FftThreshold) {
+    std::vector<double> res(a.size() + b.size() - 1, 0.0);
+    SchoolbookMultiplyDouble(a.data(), (int) a.size(), b.data(), (int) b.size(), res.data());
+    return res;
+  }
+  std::vector<long double> prod = DenseMultiply(std::vector<long double>(a.begin(), a.end()),
+                                                std::vector<long double>(b.begin(), b.end()));
+  return std::vector<double>(prod.begin(), prod.end());
+}
+
+// Рациональные: общий знаменатель выносится, а числители, если влезают в long long,
+// перемножаются как целые со сложением в __int128 — без НОД на каждой операции
+template<>
+std::vector<Rational> DenseProduct(const std::vector<Rational> &a, const std::vector<Rational> &b) {
+  auto scale = [](const std::vector<Rational> &v, BigInt &den, std::vector<long long> &num, long double &top) {
+    den = BigInt(1ll);
+    for (auto &x: v) {
+      den = den / BigInt::Gcd(den, x.Den()) * x.Den();
+    }
+    num.resize(v.size());
+    top = 0;
+    for (size_t i = 0; i < v.size(); i++) {
+      if (!(v[i].Num() * (den / v[i].Den())).ToInt64(num[i])) {
+        return false;
+      }
+      top = std::max(top, std::abs((long double) num[i]));
+    }
+    return true;
+  };
+  BigInt da, db;
+  std::vector<long long> na, nb;
+  long double ta, tb;
+  // сумма min(n, m) произведений должна остаться в __int128
+  if (!scale(a, da, na, ta) or !scale(b, db, nb, tb) or
+      ta * tb * std::min(a.size(), b.size()) >= std::ldexp(1.0L, 126)) {
+    std::vector<Rational> res(a.size() + b.size() - 1);
+    for (size_t i = 0; i < a.size(); i++) {
+      JobCheckpoint((double) i / a.size());
+      for (size_t j = 0; j < b.size(); j++) {
+        res[i + j] += a[i] * b[j];
+      }
+    }
+    return res;
+  }
+  std::vector<__int128> acc(a.size() + b.size() - 1, 0);
+  for (size_t i = 0; i < a.size(); i++) {
+    if (na[i] == 0) {
+      continue;
+    }
+    for (size_t j = 0; j < b.size(); j++) {
+      acc[i + j] += (__int128) na[i] * nb[j];
+    }
+  }
+  BigInt den = da * db;
+  std::vector<Rational> res(acc.size());
+  for (size_t k = 0; k < acc.size(); k++) {
+    if (acc[k] != 0) {
+      res[k] = Rational(BigInt(acc[k]), den);
+    }
+  }
+  return res;
+}
+
+// Арифметика Монтгомери по модулю, известному только при запуске (нечётный, меньше 2^30)
+struct MontgomeryMod {
+  uint32_t p;
+  uint32_t neg_inv;
+  uint32_t r2;
+
+  explicit MontgomeryMod(uint32_t p)
+      : p(p), neg_inv(-MontgomeryInverse(p)), r2((uint32_t) (((unsigned __int128) 1 << 64) % p)) {
+  }
+
+  uint32_t Reduce(uint64_t t) const {
+    uint32_t m = (uint32_t) t * neg_inv;
+    return Fix((uint32_t) ((t + (uint64_t) m * p) >> 32) - p);
+  }
+
+  // x из [-p, p) как int32 -> [0, p) без ветвлений: на случайных данных ветка угадывается плохо
+  uint32_t Fix(uint32_t x) const {
+    return x + (p & -(x >> 31));
+  }
+
+  uint32_t To(uint32_t x) const {
+    return Reduce((uint64_t) x * r2);
+  }
+
+  uint32_t From(uint32_t x) const {
+    return Reduce(x);
+  }
+
+  uint32_t Mul(uint32_t a, uint32_t b) const {
+    return Reduce((uint64_t) a * b);
+  }
+
+  uint32_t Add(uint32_t a, uint32_t b) const {
+    return Fix(a + b - p);
+  }
+
+  uint32_t Sub(uint32_t a, uint32_t b) const {
+    return Fix(a - b);
+  }
+
+  // a и результат — в форме Монтгомери
+  uint32_t Pow(uint32_t a, uint64_t e) const {
+    uint32_t res = To(1);
+    for (; e > 0; e >>= 1) {
+      if (e & 1) {
+        res = Mul(res, a);
+      }
+      a = Mul(a, a);
+    }
+    return res;
+  }
+};
+
+// Простые p < 2^30 вида c * 2^log + 1 по убыванию, пока их произведение не станет не меньше 2^bits.
+// Пустой результат, если таких простых на это не хватает.
+std::vector<uint32_t> NttPrimes(int log, int bits) {
+  std::vector<uint32_t> res;
+  // нижняя оценка log2 произведения: у каждого простого берётся floor(log2 p)
+  int covered = 0;
+  for (uint64_t c = ((1ull << 30) - 2) >> log; c > 0 and covered < bits; c--) {
+    uint64_t p = (c << log) + 1;
+    if (IsPrime64(p)) {
+      res.push_back((uint32_t) p);
+      covered += 63 - __builtin_clzll(p);
+    }
+  }
+  if (covered < bits) {
+    res.clear();
+  }
+  return res;
+}
+
+// Первообразный корень по модулю простого p
+uint32_t PrimitiveRoot(uint32_t p) {
+  std::vector<uint64_t> primes;
+  Factorize(p - 1, primes);
+  for (uint32_t g = 2;; g++) {
+    bool ok = true;
+    for (uint64_t q: primes) {
+      ok = ok and PowMod(g, (p - 1) / q, p) != 1;
+    }
+    if (ok) {
+      return g;
+    }
+  }
+}
+
+// Циклическая свёртка на месте; все значения — в форме Монтгомери, длина — степень двойки
+void Ntt(std::vector<uint32_t> &a, const MontgomeryMod &mod, uint32_t root, bool invert) {
+  size_t n = a.size();
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(a[i], a[j]);
+    }
+  }
+  // корни этапа длины 2h лежат подряд: roots[h + j] = w_2h^j
+  std::vector<uint32_t> roots(std::max<size_t>(n, 2));
+  for (size_t half = 1; half < n; half <<= 1) {
+    uint32_t w = mod.Pow(mod.To(root), (mod.p - 1) / (2 * half));
+    if (invert) {
+      w = mod.Pow(w, mod.p - 2);
+    }
+    roots[half] = mod.To(1);
+    for (size_t j = 1; j < half; j++) {
+      roots[half + j] = mod.Mul(roots[half + j - 1], w);
+    }
+  }
+  for (size_t half = 1; half < n; half <<= 1) {
+    const uint32_t *w = roots.data() + half;
+    for (size_t i = 0; i < n; i += 2 * half) {
+      for (size_t j = 0; j < half; j++) {
+        uint32_t u = a[i + j];
+        uint32_t v = mod.Mul(a[i + j + half], w[j]);
+        a[i + j] = mod.Add(u, v);
+        a[i + j + half] = mod.Sub(u, v);
+      }
+    }
+  }
+  if (invert) {
+    uint32_t inv_n = mod.Pow(mod.To((uint32_t) n), mod.p - 2);
+    for (auto &x: a) {
+      x = mod.Mul(x, inv_n);
+    }
+  }
+}
+
+// Член разреженного входа: позиция в плотном массиве и коэффициент
+struct SparseCoef {
+  size_t pos;
+  const BigInt *cf;
+};
+
+// Наибольшая длина свёртки, под которую ещё хватает NTT-простых
+const int MaxNttLog = 22;
+
+// Точное произведение целочисленных многочленов длины na и nb.
+// Коэффициенты произведения по модулю меньше max|a| * max|b| * min(na, nb); столько бит
+// набирается из NTT-простых, свёртка по каждому считается своим потоком пула,
+// а коэффициенты собираются китайской теоремой об остатках (схема Гарнера).
+// В out — ненулевые коэффициенты по возрастанию позиции; false, если длина или разрядность
+// больше, чем позволяют простые меньше 2^30 (тогда надо умножать иначе).
+bool MultiModularProduct(const std::vector<SparseCoef> &a, size_t na, const std::vector<SparseCoef> &b, size_t nb,
+                         std::vector<std::pair<size_t, BigInt> > &out) {
+  out.clear();
+  if (a.empty() or b.empty()) {
+    return true;
+  }
+  size_t len = na + nb - 1;
+  int log = 0;
+  while (((size_t) 1 << log) < len) {
+    log++;
+  }
+  if (log > MaxNttLog) {
+    return false;
+  }
+  int bits_a = 0, bits_b = 0;
+  for (auto &x: a) {
+    bits_a = std::max(bits_a, x.cf->BitLength());
+  }
+  for (auto &x: b) {
+    bits_b = std::max(bits_b, x.cf->BitLength());
+  }
+  // знак требует ещё одного бита
+  int bits = bits_a + bits_b + 64 - __builtin_clzll(std::min(a.size(), b.size())) + 1;
+  std::vector<uint32_t> primes = NttPrimes(log, bits);
+  if (primes.empty()) {
+    return false;
+  }
+  int count = (int) primes.size();
+  JobCheckpoint(0);
+
+  size_t n = (size_t) 1 << log;
+  std::vector<std::vector<uint32_t> > residues(count);
+  DefaultPool().ParallelFor(count, 1, [&](long long begin, long long end) {
+    for (long long t = begin; t < end; t++) {
+      MontgomeryMod mod(primes[t]);
+      uint32_t root = PrimitiveRoot(primes[t]);
+      std::vector<uint32_t> fa(n, 0), fb(n, 0);
+      for (auto &x: a) {
+        fa[x.pos] = mod.To(x.cf->Mod(mod.p));
+      }
+      for (auto &x: b) {
+        fb[x.pos] = mod.To(x.cf->Mod(mod.p));
+      }
+      Ntt(fa, mod, root, false);
+      Ntt(fb, mod, root, false);
+      for (size_t i = 0; i < n; i++) {
+        fa[i] = mod.Mul(fa[i], fb[i]);
+      }
+      Ntt(fa, mod, root, true);
+      fa.resize(len);
+      for (auto &x: fa) {
+        x = mod.From(x);
+      }
+      residues[t] = std::move(fa);
+    }
+  });
+  JobCheckpoint(0.5);
+
+  // inv[i][j] = p_i^-1 mod p_j для i < j
+  std::vector<std::vector<uint32_t> > inv(count, std::vector<uint32_t>(count));
+  for (int i = 0; i < count; i++) {
+    for (int j = i + 1; j < count; j++) {
+      inv[i][j] = (uint32_t) PowMod(primes[i] % primes[j], primes[j] - 2, primes[j]);
+    }
+  }
+  BigInt modulus(1ll);
+  for (uint32_t p: primes) {
+    modulus = modulus * BigInt((long long) p);
+  }
+  BigInt half = modulus.Shifted(-1);
+
+  std::vector<std::vector<std::pair<size_t, BigInt> > > parts((len + 4095) / 4096);
+  DefaultPool().ParallelFor((long long) parts.size(), 1, [&](long long begin, long long end) {
+    std::vector<uint32_t> digits(count);
+    for (long long part = begin; part < end; part++) {
+      for (size_t k = part * 4096; k < std::min(len, (size_t) (part + 1) * 4096); k++) {
+        bool zero = true;
+        for (int j = 0; j < count; j++) {
+          uint64_t x = residues[j][k];
+          for (int i = 0; i < j; i++) {
+            x = (x + primes[j] - digits[i] % primes[j]) * inv[i][j] % primes[j];
+          }
+          digits[j] = (uint32_t) x;
+          zero = zero and x == 0;
+        }
+        if (zero) {
+          continue;
+        }
+        BigInt value((long long) digits[count - 1]);
+        for (int j = count - 2; j >= 0; j--) {
+          value.MulAdd(primes[j], digits[j]);
+        }
+        if (half < value) {
+          value = value - modulus;
+        }
+        parts[part].emplace_back(k, std::move(value));
+      }
+    }
+  });
+  for (auto &part: parts) {
+    std::move(part.begin(), part.end(), std::back_inserter(out));
+  }
+  return true;
+}
+
+// Плотное целочисленное: через MultiModularProduct, если оно берётся, иначе школьное
+template<>
+std::vector<BigInt> DenseProduct(const std::vector<BigInt> &a, const std::vector<BigInt> &b) {
+  std::vector<SparseCoef> sa, sb;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (!a[i].IsZero()) {
+      sa.push_back(SparseCoef{i, &a[i]});
+    }
+  }
+  for (size_t i = 0; i < b.size(); i++) {
+    if (!b[i].IsZero()) {
+      sb.push_back(SparseCoef{i, &b[i]});
+    }
+  }
+  std::vector<std::pair<size_t, BigInt> > prod;
+  std::vector<BigInt> res(a.size() + b.size() - 1);
+  if (MultiModularProduct(sa, a.size(), sb, b.size(), prod)) {
+    for (auto &x: prod) {
+      res[x.first] = std::move(x.second);
+    }
+    return res;
+  }
+  for (auto &x: sa) {
+    JobCheckpoint((double) x.pos / a.size());
+    for (auto &y: sb) {
+      res[x.pos + y.pos] += *x.cf * *y.cf;
+    }
+  }
+  return res;
+}
+
+// Кронекерова подстановка: степень по каждой переменной становится цифрой смешанной системы
+// с основанием (степень произведения по ней + 1), 'a' — старшая цифра, так что порядок позиций
+// совпадает с порядком ExpKey. Многомерное произведение сводится к одной MultiModularProduct.
+// false, если плотный массив вышел бы слишком длинным или заметно разреженнее пар членов.
+bool KroneckerMultiply(const BasicTermStore<BigInt> &a, const BasicTermStore<BigInt> &b, BasicTermStore<BigInt> &res) {
+  if (a.Empty() or b.Empty()) {
+    return false;
+  }
+  int max_a[LenAlphabet] = {}, max_b[LenAlphabet] = {};
+  for (auto term: a) {
+    for (int mask = term.deg.Mask(); mask != 0; mask &= mask - 1) {
+      int v = __builtin_ctz(mask);
+      max_a[v] = std::max(max_a[v], (int) term.deg[v]);
+    }
+  }
+  for (auto term: b) {
+    for (int mask = term.deg.Mask(); mask != 0; mask &= mask - 1) {
+      int v = __builtin_ctz(mask);
+      max_b[v] = std::max(max_b[v], (int) term.deg[v]);
+    }
+  }
+  size_t stride[LenAlphabet], radix[LenAlphabet];
+  size_t total = 1;
+  for (int v = LenAlphabet - 1; v >= 0; v--) {
+    stride[v] = total;
+    radix[v] = (size_t) max_a[v] + max_b[v] + 1;
+    total *= radix[v];
+    if (total > ((size_t) 1 << MaxNttLog)) {
+      return false;
+    }
+  }
+  if (total > (size_t) 4 * a.GetSize() * b.GetSize()) {
+    return false;
+  }
+  auto pack = [&](const BasicTermStore<BigInt> &p, std::vector<SparseCoef> &out) {
+    size_t top = 0;
+    for (auto term: p) {
+      size_t pos = 0;
+      for (int mask = term.deg.Mask(); mask != 0; mask &= mask - 1) {
+        int v = __builtin_ctz(mask);
+        pos += term.deg[v] * stride[v];
+      }
+      out.push_back(SparseCoef{pos, &term.cf});
+      top = std::max(top, pos);
+    }
+    return top + 1;
+  };
+  std::vector<SparseCoef> sa, sb;
+  size_t na = pack(a, sa), nb = pack(b, sb);
+  std::vector<std::pair<size_t, BigInt> > prod;
+  if (!MultiModularProduct(sa, na, sb, nb, prod)) {
+    return false;
+  }
+  res.Clear();
+  res.Reserve((int) prod.size());
+  for (auto &x: prod) {
+    ExpKey deg;
+    for (int v = 0; v < LenAlphabet; v++) {
+      deg[v] = (uint16_t) (x.first / stride[v] % radix[v]);
+    }
+    res.PushBack(std::move(x.second), deg);
+  }
+  return true;
+}
+
+// Разреженный многочлен над кольцом коэффициентов R (см. Ring): double и long double,
+// точные Checked<int64_t> / Checked<__int128> / BigInt, поле Zp<P> и Rational.
+// Умеет сложение, вычитание, умножение, производную и сравнение; у точных колец сравнение
+// и сокращение членов точные. Корни, вычисление и база остаются у Polynomial (long double).
+template<typename R>
+class BasicPolynomial {
+  BasicTermStore<R> monos;
+
+  void Normalize() {
+    monos.Normalize();
+  }
+
+  void AppendTerm(std::string &out, int i) const {
+    std::string num;
+    Ring<R>::Format(num, monos.Cf(i));
+    bool negative = !num.empty() and num[0] == '-';
+    if (negative) {
+      out += "- ";
+      num.erase(0, 1);
+    } else if (i != 0) {
+      out += "+ ";
+    }
+    if (num != "1" or monos.Deg(i).Mask() == 0) {
+      out += num;
+    }
+    AppendVariables(out, monos.Deg(i));
+    out += ' ';
+  }
+
+ public:
+  BasicPolynomial() = default;
+
+  // Бросает std::domain_error, если какой-то коэффициент не представим в R
+  explicit BasicPolynomial(const Polynomial &p);
+
+  // Запись как у Polynomial; бросает строку с ошибкой разбора
+  explicit BasicPolynomial(std::string_view s) : BasicPolynomial(Polynomial(s)) {
+  }
+
+  // Члены в любом порядке; подобные складываются, нулевые выбрасываются
+  explicit BasicPolynomial(BasicTermStore<R> terms) : monos(std::move(terms)) {
+    Normalize();
+  }
+
+  Polynomial ToPolynomial() const;
+
+  int GetSize() const {
+    return monos.GetSize();
+  }
+
+  bool IsEmpty() const {
+    return monos.Empty();
+  }
+
+  int GetMask() const {
+    int mask = 0;
+    for (auto term: monos) {
+      mask |= term.deg.Mask();
+    }
+    return mask;
+  }
+
+  bool operator ==(const BasicPolynomial &other) const {
+    if (monos.GetSize() != other.monos.GetSize()) {
+      return false;
+    }
+    for (int i = 0; i < monos.GetSize(); i++) {
+      if (monos.Deg(i) != other.monos.Deg(i) or !Ring<R>::IsZero(monos.Cf(i) - other.monos.Cf(i))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  BasicPolynomial &operator +=(const BasicPolynomial &other) {
+    monos.MergeSorted(other.monos, false);
+    return *this;
+  }
+
+  BasicPolynomial &operator -=(const BasicPolynomial &other) {
+    monos.MergeSorted(other.monos, true);
+    return *this;
+  }
+
+  BasicPolynomial operator +(const BasicPolynomial &other) const {
+    BasicPolynomial res;
+    res.monos.Reserve(monos.GetSize() + other.monos.GetSize());
+    res.monos.Append(monos);
+    return std::move(res += other);
+  }
+
+  BasicPolynomial operator -(const BasicPolynomial &other) const {
+    BasicPolynomial res;
+    res.monos.Reserve(monos.GetSize() + other.monos.GetSize());
+    res.monos.Append(monos);
+    return std::move(res -= other);
+  }
+
+  BasicPolynomial operator *(const BasicPolynomial &other) const;
+
+  BasicPolynomial derivative(int ind) const {
+    BasicPolynomial res;
+    res.monos.Reserve(monos.GetSize());
+    for (auto term: monos) {
+      if (term.deg[ind] != 0) {
+        res.monos.PushBack(term.cf * R((long long) term.deg[ind]), term.deg);
+        res.monos.back().deg[ind]--;
+      }
+    }
+    res.Normalize();
+    return res;
+  }
+
+  void Format(std::string &out) const {
+    for (int i = 0; i < monos.GetSize(); i++) {
+      AppendTerm(out, i);
+    }
+  }
+
+  // Как Polynomial::Preview: начало записи длиной около limit символов, "0" для нулевого
+  std::string Preview(size_t limit) const {
+    if (monos.Empty()) {
+      return "0";
+    }
+    std::string res;
+    for (int i = 0; i < monos.GetSize(); i++) {
+      if (res.size() >= limit) {
+        res += "... (" + std::to_string(monos.GetSize()) + " terms)";
+        break;
+      }
+      AppendTerm(res, i);
+    }
+    return res;
+  }
+
+  std::string GetString() const {
+    std::string res;
+    Format(res);
+    return res;
+  }
+};
+
+// Члены берутся в лексикографическом порядке, в каком бы ни хранился p
+template<typename R>
+BasicPolynomial<R>::BasicPolynomial(const Polynomial &p) {
+  monos.Reserve(p.monos.GetSize());
+  for (auto term: p.monos) {
+    monos.PushBack(Ring<R>::FromLongDouble(term.cf), term.deg);
+  }
+  Normalize();
+}
+
+template<typename R>
+Polynomial BasicPolynomial<R>::ToPolynomial() const {
+  Polynomial res;
+  res.monos.Reserve(monos.GetSize());
+  for (auto term: monos) {
+    res.monos.PushBack(Ring<R>::ToLongDouble(term.cf), term.deg);
+  }
+  // перевод в long double может дать пренебрежимо малые коэффициенты
+  res.Normalize();
+  return res;
+}
+
+// Как у Polynomial: плотные одномерные — DenseProduct своего кольца, остальные — кучей
+template<typename R>
+BasicPolynomial<R> BasicPolynomial<R>::operator *(const BasicPolynomial &other) const {
+  BasicPolynomial res;
+  // целые коэффициенты: точное многомодульное умножение, если оно выгоднее кучи
+  if constexpr (std::is_same<R, BigInt>::value) {
+    if (KroneckerMultiply(monos, other.monos, res.monos)) {
+      return res;
+    }
+  }
+  int mask = GetMask() | other.GetMask();
+  if (!IsEmpty() and !other.IsEmpty() and (mask & (mask - 1)) == 0) {
+    int var = mask ? __builtin_ctz(mask) : 0;
+    int n = monos.back().deg[var] + 1, m = other.monos.back().deg[var] + 1;
+    if ((long long) n + m - 2 > ExpKey::MaxDeg) {
+      throw std::overflow_error("Degree " + std::to_string(n + m - 2) + " is out of range");
+    }
+    if (monos.GetSize() >= DenseFill * n and other.monos.GetSize() >= DenseFill * m) {
+      std::vector<R> a(n), b(m);
+      for (auto term: monos) {
+        a[term.deg[var]] = term.cf;
+      }
+      for (auto term: other.monos) {
+        b[term.deg[var]] = term.cf;
+      }
+      std::vector<R> prod = DenseProduct(a, b);
+      for (int k = 0; k < (int) prod.size(); k++) {
+        if (!Ring<R>::IsZero(prod[k])) {
+          ExpKey deg;
+          deg[var] = (uint16_t) k;
+          res.monos.PushBack(prod[k], deg);
+        }
+      }
+      return res;
+    }
+  }
+  res.monos = HeapMultiply(monos, other.monos);
+  res.Normalize();
+  return res;
+}
+
+// Кольца коэффициентов, которые фронтенд предлагает для умножения
+enum class CoefRing {
+  Auto,
+  LongDouble,
+  Double,
+  Int64,
+  Int128,
+  Rational,
+  Mod998
+};
+
+// Произведение в BasicPolynomial<R>: начало записи в этом кольце и результат в long double в порядке a
+template<typename R>
+std::pair<std::string, Polynomial> ProductIn(const Polynomial &a, const Polynomial &b, size_t limit) {
+  BasicPolynomial<R> prod = BasicPolynomial<R>(a) * BasicPolynomial<R>(b);
+  Polynomial res = prod.ToPolynomial();
+  res.SetOrder(a.GetOrder());
+  return make_pair_custom(prod.Preview(limit), std::move(res));
+}
+
+// Произведение с коэффициентами в кольце ring: запись результата в этом кольце (около limit символов)
+// и он же в long double. Auto перемножает целые входы точно в BigInt (Кронекер и многомодульное NTT,
+// если они берутся), остальные — как Polynomial::operator*, и тогда запись пустая.
+// Бросает std::domain_error, если коэффициент не представим в кольце, и std::overflow_error
+// при переполнении Checked.
+std::pair<std::string, Polynomial> RingProduct(const Polynomial &a, const Polynomial &b, CoefRing ring,
+                                               size_t limit) {
+  switch (ring) {
+    case CoefRing::LongDouble:
+      return ProductIn<long double>(a, b, limit);
+    case CoefRing::Double:
+      return ProductIn<double>(a, b, limit);
+    case CoefRing::Int64:
+      return ProductIn<Checked<int64_t> >(a, b, limit);
+    case CoefRing::Int128:
+      return ProductIn<Checked<__int128> >(a, b, limit);
+    case CoefRing::Rational:
+      return ProductIn<Rational>(a, b, limit);
+    case CoefRing::Mod998:
+      return ProductIn<Z998>(a, b, limit);
+    case CoefRing::Auto:
+      break;
+  }
+  if (a.HasIntegerCoefficients() and b.HasIntegerCoefficients()) {
+    return ProductIn<BigInt>(a, b, limit);
+  }
+  return make_pair_custom(std::string(), a * b);
+}
+
+// Базис Грёбнера над полем вычетов F в стиле F4: все пары с наименьшей степенью НОК
+// редуцируются разом как строки одной разреженной матрицы, лишние пары отсекаются
+// критериями Гебауэра–Мёллера. Многочлены базиса хранятся нормированными (старший коэффициент 1).
+template<typename F>
+class GroebnerEngine {
+  using Store = BasicTermStore<F>;
+
+  struct Pair {
+    int i, j;
+    ExpKey lcm;
+    long long degree;
+  };
+
+  // строка матрицы до построения: basis[poly] * x^mult
+  struct RowSpec {
+    int poly;
+    ExpKey mult;
+  };
+
+  // разреженная строка: столбцы по возрастанию (столбец 0 — старший моном) и коэффициенты
+  struct Row {
+    std::vector<int> cols;
+    std::vector<F> cfs;
+  };
+
+  struct KeyHash {
+    size_t operator ()(const ExpKey &key) const {
+      return key.Hash();
+    }
+  };
+
+  MonomialOrder order;
+  std::vector<Store> basis;
+  std::vector<char> active;
+  std::vector<Pair> pairs;
+
+  const ExpKey &Lead(int k) const {
+    return basis[k].back().deg;
+  }
+
+  static void MakeMonic(Store &p) {
+    F inv = F(1) / p.back().cf;
+    for (auto term: p) {
+      term.cf = term.cf * inv;
+    }
+  }
+
+  static bool Coprime(const ExpKey &a, const ExpKey &b) {
+    return (a.Mask() & b.Mask()) == 0;
+  }
+
+  // Добавляет basis[h] и обновляет пары (Update из книги Беккера–Вайспфеннинга)
+  void Update(int h) {
+    const ExpKey lh = Lead(h);
+    std::vector<int> cand;
+    std::vector<ExpKey> lcms;
+    for (int g = 0; g < h; g++) {
+      if (active[g]) {
+        cand.push_back(g);
+        lcms.push_back(lh.Lcm(Lead(g)));
+      }
+    }
+    // новая пара (h, g1) не нужна, если НОК другой пары (h, g2) делит её НОК;
+    // из пар с равными НОК остаётся последняя, пары с взаимно простыми мономами остаются всегда
+    std::vector<int> kept;
+    for (size_t a = 0; a < cand.size(); a++) {
+      bool keep = true;
+      if (!Coprime(lh, Lead(cand[a]))) {
+        for (size_t b = a + 1; b < cand.size() and keep; b++) {
+          keep = !lcms[b].Divides(lcms[a]);
+        }
+        for (size_t b = 0; b < kept.size() and keep; b++) {
+          keep = !lcms[kept[b]].Divides(lcms[a]);
+        }
+      }
+      if (keep) {
+        kept.push_back((int) a);
+      }
+    }
+    // старая пара (i, j) не нужна, если LT(h) делит её НОК и НОК пар с h от него отличаются
+    size_t out = 0;
+    for (size_t k = 0; k < pairs.size(); k++) {
+      const Pair &p = pairs[k];
+      if (lh.Divides(p.lcm) and lh.Lcm(Lead(p.i)) != p.lcm and lh.Lcm(Lead(p.j)) != p.lcm) {
+        continue;
+      }
+      pairs[out++] = p;
+    }
+    pairs.resize(out);
+    // критерий произведения: S-многочлен пары со взаимно простыми старшими мономами редуцируется в 0
+    for (int a: kept) {
+      if (!Coprime(lh, Lead(cand[a]))) {
+        pairs.push_back(Pair{cand[a], h, lcms[a], lcms[a].TotalDegree()});
+      }
+    }
+    for (int g: cand) {
+      if (lh.Divides(Lead(g))) {
+        active[g] = 0;
+      }
+    }
+    active[h] = 1;
+  }
+
+  void Add(Store p) {
+    MakeMonic(p);
+    basis.push_back(std::move(p));
+    active.push_back(0);
+    Update((int) basis.size() - 1);
+  }
+
+  // Символьная предобработка: у каждого встреченного монома, делящегося на чей-то старший,
+  // должна быть строка с ним во главе. Редуктор — делитель с наименьшим числом членов, его строка
+  // дописывается в specs. Заполняет столбцы (мономы по убыванию) и строит строки.
+  void Preprocess(std::vector<RowSpec> &specs, std::vector<ExpKey> &monos, std::vector<Row> &rows) {
+    std::unordered_map<ExpKey, int, KeyHash> cols;
+    std::vector<ExpKey> todo;
+    auto touch = [&](const RowSpec &spec) {
+      for (auto term: basis[spec.poly]) {
+        ExpKey m = term.deg + spec.mult;
+        if (cols.emplace(m, 0).second) {
+          monos.push_back(m);
+          todo.push_back(m);
+        }
+      }
+    };
+    for (const RowSpec &spec: specs) {
+      touch(spec);
+    }
+    for (const RowSpec &spec: specs) {
+      cols[Lead(spec.poly) + spec.mult] = 1;
+    }
+    while (!todo.empty()) {
+      ExpKey m = todo.back();
+      todo.pop_back();
+      if (cols[m] == 1) {
+        continue;
+      }
+      int best = -1;
+      for (int k = 0; k < (int) basis.size(); k++) {
+        if (Lead(k).Divides(m) and (best == -1 or basis[k].GetSize() < basis[best].GetSize())) {
+          best = k;
+        }
+      }
+      if (best != -1) {
+        cols[m] = 1;
+        specs.push_back(RowSpec{best, m - Lead(best)});
+        touch(specs.back());
+      }
+    }
+
+    OrderLess less{order};
+    std::sort(monos.begin(), monos.end(), [&](const ExpKey &a, const ExpKey &b) {
+      return less(b, a);
+    });
+    for (int c = 0; c < (int) monos.size(); c++) {
+      cols[monos[c]] = c;
+    }
+    rows.assign(specs.size(), Row());
+    DefaultPool().ParallelFor((long long) specs.size(), 64, [&](long long begin, long long end) {
+      for (long long r = begin; r < end; r++) {
+        const Store &p = basis[specs[r].poly];
+        rows[r].cols.reserve(p.GetSize());
+        rows[r].cfs.reserve(p.GetSize());
+        for (int t = p.GetSize() - 1; t >= 0; t--) {
+          rows[r].cols.push_back(cols.find(p.Deg(t) + specs[r].mult)->second);
+          rows[r].cfs.push_back(p.Cf(t));
+        }
+      }
+    });
+  }
+
+  // Редуцирует строку src[self] нормированными ведущими строками src[piv[c]] слева направо;
+  // сама строка может быть ведущей для своего старшего столбца. dense — нулевой буфер на все столбцы.
+  static Row ReduceRow(const std::vector<Row> &src, int self, const std::vector<int> &piv, std::vector<F> &dense) {
+    const Row &row = src[self];
+    for (size_t t = 0; t < row.cols.size(); t++) {
+      dense[row.cols[t]] = row.cfs[t];
+    }
+    Row res;
+    for (int c = row.cols[0]; c < (int) dense.size(); c++) {
+      if (dense[c] == F()) {
+        continue;
+      }
+      if (piv[c] == -1 or piv[c] == self) {
+        res.cols.push_back(c);
+        res.cfs.push_back(dense[c]);
+        dense[c] = F();
+        continue;
+      }
+      F f = dense[c];
+      const Row &p = src[piv[c]];
+      for (size_t t = 0; t < p.cols.size(); t++) {
+        dense[p.cols[t]] = dense[p.cols[t]] - f * p.cfs[t];
+      }
+    }
+    return res;
+  }
+
+  // Строки rest, редуцированные ведущими строками параллельно, по буферу на кусок
+  static std::vector<Row> ReduceRows(const std::vector<Row> &rows, const std::vector<int> &rest,
+                                     const std::vector<int> &pivot) {
+    std::vector<Row> res(rest.size());
+    DefaultPool().ParallelFor((long long) rest.size(), 16, [&](long long begin, long long end) {
+      std::vector<F> dense(pivot.size());
+      for (long long k = begin; k < end; k++) {
+        res[k] = ReduceRow(rows, rest[k], pivot, dense);
+      }
+    });
+    return res;
+  }
+
+  Store ToStore(const Row &row, const std::vector<ExpKey> &monos) const {
+    Store p;
+    p.Reserve((int) row.cols.size());
+    for (int t = (int) row.cols.size() - 1; t >= 0; t--) {
+      p.PushBack(row.cfs[t], monos[row.cols[t]]);
+    }
+    return p;
+  }
+
+  // Один шаг F4: пары наименьшей степени, символьная предобработка, редукция матрицы
+  void Step() {
+    long long degree = pairs[0].degree;
+    for (const Pair &p: pairs) {
+      degree = std::min(degree, p.degree);
+    }
+    std::vector<RowSpec> specs;
+    size_t out = 0;
+    for (size_t k = 0; k < pairs.size(); k++) {
+      const Pair &p = pairs[k];
+      if (p.degree != degree) {
+        pairs[out++] = p;
+        continue;
+      }
+      specs.push_back(RowSpec{p.i, p.lcm - Lead(p.i)});
+      specs.push_back(RowSpec{p.j, p.lcm - Lead(p.j)});
+    }
+    pairs.resize(out);
+    std::sort(specs.begin(), specs.end(), [](const RowSpec &a, const RowSpec &b) {
+      return a.poly != b.poly ? a.poly < b.poly : a.mult < b.mult;
+    });
+    specs.erase(std::unique(specs.begin(), specs.end(), [](const RowSpec &a, const RowSpec &b) {
+      return a.poly == b.poly and a.mult == b.mult;
+    }), specs.end());
+    std::vector<ExpKey> monos;
+    std::vector<Row> rows;
+    Preprocess(specs, monos, rows);
+
+    // по ведущей строке на каждый старший столбец, остальные строки редуцируются ими
+    std::vector<int> pivot(monos.size(), -1);
+    std::vector<int> rest;
+    for (int r = 0; r < (int) rows.size(); r++) {
+      if (pivot[rows[r].cols[0]] == -1) {
+        pivot[rows[r].cols[0]] = r;
+      } else {
+        rest.push_back(r);
+      }
+    }
+    std::vector<Row> reduced = ReduceRows(rows, rest, pivot);
+
+    // приведение остатков между собой; строки с новыми старшими мономами — новые элементы базиса
+    std::vector<Row> fresh;
+    std::vector<int> fresh_pivot(monos.size(), -1);
+    std::vector<F> dense(monos.size());
+    for (Row &row: reduced) {
+      if (row.cols.empty()) {
+        continue;
+      }
+      fresh.push_back(std::move(row));
+      Row res = ReduceRow(fresh, (int) fresh.size() - 1, fresh_pivot, dense);
+      if (res.cols.empty()) {
+        fresh.pop_back();
+        continue;
+      }
+      F inv = F(1) / res.cfs[0];
+      for (F &cf: res.cfs) {
+        cf = cf * inv;
+      }
+      fresh_pivot[res.cols[0]] = (int) fresh.size() - 1;
+      fresh.back() = std::move(res);
+    }
+    for (const Row &row: fresh) {
+      Add(ToStore(row, monos));
+    }
+  }
+
+ public:
+  explicit GroebnerEngine(MonomialOrder order) : order(order) {
+  }
+
+  // Приведённый базис идеала, порождённого gens (члены упорядочены по order);
+  // элементы нормированы и идут по убыванию старших мономов
+  std::vector<Store> Compute(std::vector<Store> gens) {
+    for (Store &g: gens) {
+      g.Normalize(order);
+      if (!g.Empty()) {
+        Add(std::move(g));
+      }
+    }
+    while (!pairs.empty()) {
+      JobCheckpoint();
+      Step();
+    }
+    // минимальный базис: старший моном не делится на старший моном другого элемента
+    std::vector<RowSpec> specs;
+    for (int k = 0; k < (int) basis.size(); k++) {
+      bool minimal = active[k];
+      for (int j = 0; j < (int) basis.size() and minimal; j++) {
+        minimal = !(active[j] and j != k and Lead(j).Divides(Lead(k)) and (Lead(j) != Lead(k) or j < k));
+      }
+      if (minimal) {
+        specs.push_back(RowSpec{k, ExpKey()});
+      }
+    }
+    OrderLess less{order};
+    std::sort(specs.begin(), specs.end(), [&](const RowSpec &a, const RowSpec &b) {
+      return less(Lead(b.poly), Lead(a.poly));
+    });
+    // приведённый: хвосты редуцируются той же матрицей, где элементы — ведущие строки своих старших мономов
+    int count = (int) specs.size();
+    std::vector<ExpKey> monos;
+    std::vector<Row> rows;
+    Preprocess(specs, monos, rows);
+    std::vector<int> pivot(monos.size(), -1);
+    std::vector<int> targets;
+    for (int r = 0; r < (int) rows.size(); r++) {
+      pivot[rows[r].cols[0]] = r;
+      if (r < count) {
+        targets.push_back(r);
+      }
+    }
+    std::vector<Store> res;
+    for (const Row &row: ReduceRows(rows, targets, pivot)) {
+      res.push_back(ToStore(row, monos));
+    }
+    return res;
+  }
+};
+
+// Простые меньше 2^30, по которым по очереди считается базис Грёбнера; 32 модуля дают
+// числители и знаменатели примерно до 2^480
+template<uint32_t... Primes>
+struct PrimeList {
+};
+
+using GroebnerPrimes = PrimeList<1073741789, 1073741783, 1073741741, 1073741723, 1073741719, 1073741717,
+                                 1073741689, 1073741671, 1073741663, 1073741651, 1073741621, 1073741567,
+                                 1073741561, 1073741527, 1073741503, 1073741477, 1073741467, 1073741441,
+                                 1073741419, 1073741399, 1073741387, 1073741381, 1073741371, 1073741329,
+                                 1073741311, 1073741309, 1073741287, 1073741237, 1073741213, 1073741197,
+                                 1073741189, 1073741173>;
+
+// Дробь num / den с |num|, den <= sqrt(m / 2), сравнимая с a по модулю m (расширенный алгоритм Евклида);
+// false, если такой нет
+bool RationalReconstruct(const BigInt &a, const BigInt &m, BigInt &num, BigInt &den) {
+  auto small = [&](const BigInt &x) {
+    return x * x * BigInt(2LL) < m;
+  };
+  BigInt r0 = m, r1 = a, t0, t1(1LL), q, r;
+  while (!small(r1)) {
+    BigInt::DivMod(r0, r1, q, r);
+    r0 = std::move(r1);
+    r1 = std::move(r);
+    BigInt t = t0 - q * t1;
+    t0 = std::move(t1);
+    t1 = std::move(t);
+  }
+  if (t1.IsZero() or !small(t1) or BigInt::Gcd(r1, t1) != BigInt(1LL)) {
+    return false;
+  }
+  num = t1.Negative() ? -r1 : r1;
+  den = t1.Negative() ? -t1 : t1;
+  return true;
+}
+
+// Модульный базис Грёбнера: базисы по простым из списка склеиваются по КТО, коэффициенты
+// восстанавливаются рациональной реконструкцией. Простые добавляются, пока реконструкция
+// не повторится на двух подряд и восстановленный базис не пройдёт проверку (Verify).
+// Простые, делящие числитель или знаменатель коэффициента образующих, пропускаются сразу.
+// Базис по неудачному простому имеет другие старшие мономы: из двух форм остаётся та,
+// у которой старшие мономы меньше, и если лучше оказалась новая, КТО начинается заново с неё.
+class ModularGroebner {
+  const std::vector<Polynomial> &gens;
+  MonomialOrder order;
+  // образующие с точными коэффициентами, в порядке order
+  std::vector<BasicTermStore<Rational> > exact;
+  // старшие мономы базиса по возрастанию
+  std::vector<ExpKey> leads;
+  // мономы каждого элемента по возрастанию; члена, которого нет в базисе по простому, там коэффициент 0
+  std::vector<std::vector<ExpKey> > shape;
+  std::vector<std::vector<BigInt> > residues;
+  BigInt modulus;
+  std::vector<std::vector<std::pair<BigInt, BigInt> > > last;
+  bool reconstructed = false;
+
+  bool Reconstruct() {
+    std::vector<std::vector<std::pair<BigInt, BigInt> > > cur(residues.size());
+    for (size_t k = 0; k < residues.size(); k++) {
+      for (const BigInt &x: residues[k]) {
+        BigInt num, den;
+        if (!RationalReconstruct(x, modulus, num, den)) {
+          reconstructed = false;
+          return false;
+        }
+        cur[k].emplace_back(std::move(num), std::move(den));
+      }
+    }
+    bool stable = reconstructed and cur == last;
+    last = std::move(cur);
+    reconstructed = true;
+    return stable;
+  }
+
+  // Старшие мономы a лучше, чем b: первый различающийся меньше, а при общем начале их больше
+  bool Better(const std::vector<ExpKey> &a, const std::vector<ExpKey> &b) const {
+    OrderLess less{order};
+    for (size_t i = 0; i < a.size() and i < b.size(); i++) {
+      if (a[i] != b[i]) {
+        return less(a[i], b[i]);
+      }
+    }
+    return a.size() > b.size();
+  }
+
+  // Восстановленный базис G проверяется точно, в рациональных числах: каждый образующий делится
+  // на G нацело (идеал лежит в <G>), и каждый S-многочлен пары из G сводится к нулю (G — базис
+  // Грёбнера); лишние пары отсекают оба критерия Бухбергера.
+  // Обратное включение G в идеал не проверяется: его даёт то, что по каждому принятому простому
+  // G совпадает с базисом идеала по модулю, а Better отбрасывает простые с другими старшими мономами.
+  bool Verify() const {
+    std::vector<BasicTermStore<Rational> > basis(shape.size());
+    std::vector<const BasicTermStore<Rational> *> divisors;
+    for (size_t k = 0; k < shape.size(); k++) {
+      for (size_t t = 0; t < shape[k].size(); t++) {
+        if (!last[k][t].first.IsZero()) {
+          basis[k].PushBack(Rational(last[k][t].first, last[k][t].second), shape[k][t]);
+        }
+      }
+      if (basis[k].Empty()) {
+        return false;
+      }
+      divisors.push_back(&basis[k]);
+    }
+    // образующие и S-многочлены сводятся независимо, поэтому делятся между потоками пула
+    std::vector<BasicTermStore<Rational> > checks(exact.begin(), exact.end());
+    for (size_t i = 0; i < basis.size(); i++) {
+      for (size_t j = i + 1; j < basis.size(); j++) {
+        const ExpKey &li = basis[i].back().deg;
+        const ExpKey &lj = basis[j].back().deg;
+        if ((li.Mask() & lj.Mask()) == 0) {
+          continue;
+        }
+        // цепной критерий: пару (i, j) покрывают пары (i, k) и (k, j) с меньшими НОК,
+        // а они проверяются здесь же или сами покрыты ещё меньшими
+        ExpKey lcm = li.Lcm(lj);
+        bool chain = false;
+        for (size_t k = 0; k < basis.size() and !chain; k++) {
+          const ExpKey &lk = basis[k].back().deg;
+          chain = k != i and k != j and lk.Divides(lcm) and li.Lcm(lk) != lcm and lj.Lcm(lk) != lcm;
+        }
+        if (chain) {
+          continue;
+        }
+        // старшие члены сокращаются точно, поэтому берутся только остальные
+        BasicTermStore<Rational> spoly;
+        spoly.MergeScaled(basis[i], Rational(1) / basis[i].back().cf, lcm - li, order, basis[i].GetSize() - 1);
+        spoly.MergeScaled(basis[j], -(Rational(1) / basis[j].back().cf), lcm - lj, order, basis[j].GetSize() - 1);
+        checks.push_back(std::move(spoly));
+      }
+    }
+    JobCheckpoint();
+    std::atomic<bool> ok{true};
+    DefaultPool().ParallelFor((long long) checks.size(), 1, [&](long long begin, long long end) {
+      for (long long t = begin; t < end and ok.load(std::memory_order_relaxed); t++) {
+        if (!ReduceBySet(std::move(checks[t]), divisors, order).Empty()) {
+          ok.store(false, std::memory_order_relaxed);
+        }
+      }
+    });
+    return ok.load();
+  }
+
+ public:
+  ModularGroebner(const std::vector<Polynomial> &gens, MonomialOrder order) : gens(gens), order(order) {
+    for (const Polynomial &g: gens) {
+      exact.emplace_back();
+      for (auto term: g.monos) {
+        exact.back().PushBack(Ring<Rational>::FromLongDouble(term.cf), term.deg);
+      }
+      exact.back().Normalize(order);
+    }
+  }
+
+  // Базис по модулю P; true, когда коэффициенты установились
+  template<uint32_t P>
+  bool AddPrime() {
+    using F = Zp<P>;
+    std::vector<BasicTermStore<F> > input(gens.size());
+    for (size_t k = 0; k < exact.size(); k++) {
+      for (auto term: exact[k]) {
+        if (term.cf.Num().Mod(P) == 0 or term.cf.Den().Mod(P) == 0) {
+          return false;
+        }
+        input[k].PushBack(F((long long) term.cf.Num().Mod(P)) / F((long long) term.cf.Den().Mod(P)), term.deg);
+      }
+    }
+    std::vector<BasicTermStore<F> > basis = GroebnerEngine<F>(order).Compute(std::move(input));
+    std::vector<ExpKey> cur_leads;
+    for (auto &g: basis) {
+      cur_leads.push_back(g.back().deg);
+    }
+    std::sort(cur_leads.begin(), cur_leads.end(), OrderLess{order});
+    if (shape.empty() or Better(cur_leads, leads)) {
+      // первое простое или все прежние были неудачными
+      leads = std::move(cur_leads);
+      shape.clear();
+      residues.clear();
+      last.clear();
+      reconstructed = false;
+      modulus = BigInt((long long) P);
+      for (auto &g: basis) {
+        shape.emplace_back();
+        residues.emplace_back();
+        for (auto term: g) {
+          shape.back().push_back(term.deg);
+          residues.back().push_back(BigInt((long long) term.cf.Value()));
+        }
+      }
+      return Reconstruct();
+    }
+    if (cur_leads != leads) {
+      return false;
+    }
+    // КТО: x' = x + M * ((b - x) / M mod P); члены, которых нет с одной из сторон, там нулевые
+    OrderLess less{order};
+    F inv = F((long long) modulus.Mod(P)).Inverse();
+    for (size_t k = 0; k < basis.size(); k++) {
+      std::vector<ExpKey> degs;
+      std::vector<BigInt> xs;
+      size_t i = 0;
+      int t = 0;
+      while (i < shape[k].size() or t < basis[k].GetSize()) {
+        bool old_term = t == basis[k].GetSize() or (i < shape[k].size() and !less(basis[k].Deg(t), shape[k][i]));
+        bool new_term = i == shape[k].size() or (t < basis[k].GetSize() and !less(shape[k][i], basis[k].Deg(t)));
+        BigInt x = old_term ? std::move(residues[k][i]) : BigInt(0LL);
+        F b = new_term ? basis[k].Cf(t) : F();
+        F lift = (b - F((long long) x.Mod(P))) * inv;
+        x += modulus * BigInt((long long) lift.Value());
+        degs.push_back(old_term ? shape[k][i] : basis[k].Deg(t));
+        xs.push_back(std::move(x));
+        i += old_term;
+        t += new_term;
+      }
+      shape[k] = std::move(degs);
+      residues[k] = std::move(xs);
+    }
+    modulus = modulus * BigInt((long long) P);
+    return Reconstruct();
+  }
+
+  template<uint32_t... Primes>
+  std::vector<Polynomial> Run(PrimeList<Primes...>) {
+    if (!((AddPrime<Primes>() and Verify()) or ...)) {
+      throw std::domain_error("Groebner basis coefficients are too large to reconstruct");
+    }
+    std::vector<Polynomial> res(shape.size());
+    for (size_t k = 0; k < shape.size(); k++) {
+      res[k].order = order;
+      res[k].monos.Reserve((int) shape[k].size());
+      for (size_t t = 0; t < shape[k].size(); t++) {
+        if (!last[k][t].first.IsZero()) {
+          res[k].monos.PushBack(last[k][t].first.ToLongDouble() / last[k][t].second.ToLongDouble(), shape[k][t]);
+        }
+      }
+    }
+    return res;
+  }
+};
+
+// Приведённый базис Грёбнера идеала, порождённого gens, в порядке order (см. ModularGroebner);
+// бросает std::domain_error, если коэффициенты не восстановились
+std::vector<Polynomial> GroebnerBasis(const std::vector<Polynomial> &gens, MonomialOrder order) {
+  return ModularGroebner(gens, order).Run(GroebnerPrimes());
+}
+
+// Файл, отображённый в память только для чтения. Там, где нет mmap, файл просто читается целиком.
+class MappedFile {
+  const char *ptr = nullptr;
+  size_t len = 0;
+  std::string fallback;
+#if defined(__unix__) || defined(__APPLE__)
+  void *mapped = nullptr;
+#endif
+
+ public:
+  explicit MappedFile(const std::string &path) {
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      throw std::runtime_error("Can not open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 and st.st_size > 0) {
+      void *res = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (res != MAP_FAILED) {
+        mapped = res;
+        ptr = (const char *) res;
+        len = (size_t) st.st_size;
+        madvise(res, len, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+    if (mapped != nullptr) {
+      return;
+    }
+#endif
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      throw std::runtime_error("Can not open " + path);
+    }
+    fallback.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    ptr = fallback.data();
+    len = fallback.size();
+  }
+
+  MappedFile(const MappedFile &) = delete;
+
+  MappedFile &operator =(const MappedFile &) = delete;
+
+  ~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped != nullptr) {
+      munmap(mapped, len);
+    }
+#endif
+  }
+
+  const char *Data() const {
+    return ptr;
+  }
+
+  size_t Size() const {
+    return len;
+  }
+};
+
+// Двоичный формат базы (версия 1):
+//   заголовок DbHeader;
+//   блоки многочленов, каждый с границы 16 байт: число членов n, число упакованных степеней k,
+//   n коэффициентов long double как есть, n масок переменных uint32, k ненулевых степеней uint16;
+//   в конце — индекс из count + 1 смещений блоков (последнее — конец данных).
+// Коэффициенты хранятся побитово, поэтому переживают сохранение и загрузку без потерь.
+struct DbHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t cf_size;
+  uint32_t cf_digits;
+  uint32_t lanes;
+  uint64_t count;
+  uint64_t index;
+  // номер последнего журнала изменений, уже вошедшего в снимок (0 — нет)
+  uint64_t journal;
+};
+
+const char DbMagic[8] = {'P', 'O', 'L', 'Y', 'D', 'B', '\x1a', '\n'};
+const uint32_t DbVersion = 1;
+
+bool IsBinaryDb(const char *data, size_t size) {
+  return size >= sizeof(DbHeader) and std::memcmp(data, DbMagic, sizeof(DbMagic)) == 0;
+}
+
+// Блок одного многочлена в двоичном формате; общий для снимков базы и журнала
+class PolyCodec {
+ public:
+  static void Encode(const Polynomial &p, std::vector<char> &out);
+
+  // Бросает runtime_error, если блок испорчен
+  static Polynomial Decode(const char *block, uint64_t size);
+};
+
+void PolyCodec::Encode(const Polynomial &p, std::vector<char> &out) {
+  // в файле члены всегда в лексикографическом порядке
+  if (p.order != MonomialOrder::Lex) {
+    Polynomial lex = p;
+    lex.SetOrder(MonomialOrder::Lex);
+    Encode(lex, out);
+    return;
+  }
+  const TermStore &monos = p.monos;
+  uint64_t n = monos.GetSize();
+  std::vector<uint32_t> masks(n);
+  std::vector<uint16_t> exps;
+  for (uint64_t i = 0; i < n; i++) {
+    const ExpKey &deg = monos.Deg((int) i);
+    masks[i] = deg.Mask();
+    for (uint32_t m = masks[i]; m != 0; m &= m - 1) {
+      exps.push_back(deg[__builtin_ctz(m)]);
+    }
+  }
+  uint64_t k = exps.size();
+  auto put = [&out](const void *data, size_t size) {
+    out.insert(out.end(), (const char *) data, (const char *) data + size);
+  };
+  put(&n, sizeof(n));
+  put(&k, sizeof(k));
+  // у 80-битного long double значимы 10 байт из 16; остальное — мусор выравнивания,
+  // поэтому коэффициенты копируются в обнулённое место и одинаковые базы дают одинаковые файлы
+  const size_t cf_bytes = LDBL_MANT_DIG == 64 ? 10 : sizeof(long double);
+  size_t at = out.size();
+  out.resize(at + n * sizeof(long double), 0);
+  for (uint64_t i = 0; i < n; i++) {
+    std::memcpy(out.data() + at + i * sizeof(long double), &monos.Cf((int) i), cf_bytes);
+  }
+  put(masks.data(), n * sizeof(uint32_t));
+  put(exps.data(), k * sizeof(uint16_t));
+}
+
+Polynomial PolyCodec::Decode(const char *block, uint64_t size) {
+  auto corrupted = [] {
+    return std::runtime_error("Corrupted database file");
+  };
+  if (size < 16) {
+    throw corrupted();
+  }
+  uint64_t n, k;
+  std::memcpy(&n, block, sizeof(n));
+  std::memcpy(&k, block + 8, sizeof(k));
+  uint64_t room = size - 16;
+  if (n > (uint64_t) INT32_MAX or n > room / (sizeof(long double) + sizeof(uint32_t)) or
+      k > (room - n * (sizeof(long double) + sizeof(uint32_t))) / sizeof(uint16_t)) {
+    throw corrupted();
+  }
+  const char *cfs = block + 16;
+  const char *masks = cfs + n * sizeof(long double);
+  const char *exps = masks + n * sizeof(uint32_t);
+
+  Polynomial res;
+  res.monos.Reserve((int) n);
+  uint64_t used = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    long double cf;
+    uint32_t mask;
+    std::memcpy(&cf, cfs + i * sizeof(long double), sizeof(cf));
+    std::memcpy(&mask, masks + i * sizeof(uint32_t), sizeof(mask));
+    if (mask >> LenAlphabet != 0 or used + __builtin_popcount(mask) > k) {
+      throw corrupted();
+    }
+    ExpKey deg;
+    for (; mask != 0; mask &= mask - 1) {
+      uint16_t e;
+      std::memcpy(&e, exps + used++ * sizeof(uint16_t), sizeof(e));
+      if (e == 0) {
+        throw corrupted();
+      }
+      deg[__builtin_ctz(mask)] = e;
+    }
+    // члены в файле уже приведены; порядок проверяем, чтобы не сломать инварианты операций
+    if (i > 0 and !(res.monos.Deg((int) i - 1) < deg)) {
+      throw corrupted();
+    }
+    res.monos.PushBack(cf, deg);
+  }
+  if (used != k) {
+    throw corrupted();
+  }
+  return res;
+}
+
+// Сбрасывает записанный файл на диск (fsync)
+void SyncFile(const std::string &path) {
+#if defined(__unix__) || defined(__APPLE__)
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1 or fsync(fd) != 0) {
+    if (fd != -1) {
+      close(fd);
+    }
+    throw std::runtime_error("Can not sync " + path);
+  }
+  close(fd);
+#endif
+}
+
+// Пишет базу потоком: блоки сразу уходят в файл, в памяти остаются только смещения
+class PolyDbWriter {
+  std::ofstream out;
+  std::string path;
+  std::vector<uint64_t> offsets;
+  std::vector<char> buf;
+  uint64_t pos = 0;
+  uint64_t journal;
+
+  void Put(const void *data, size_t size) {
+    const char *from = (const char *) data;
+    buf.insert(buf.end(), from, from + size);
+    pos += size;
+  }
+
+  void Align() {
+    static const char zeros[16] = {};
+    Put(zeros, (16 - pos % 16) % 16);
+  }
+
+  void Flush() {
+    out.write(buf.data(), (std::streamsize) buf.size());
+    buf.clear();
+    if (!out) {
+      throw std::runtime_error("Can not write " + path);
+    }
+  }
+
+ public:
+  explicit PolyDbWriter(const std::string &path, uint64_t journal = 0)
+      : out(path, std::ios::binary | std::ios::trunc), path(path), journal(journal) {
+    if (!out) {
+      throw std::runtime_error("Can not open " + path);
+    }
+    DbHeader header = {};
+    Put(&header, sizeof(header));
+    Align();
+  }
+
+  void Add(const Polynomial &p) {
+    Align();
+    offsets.push_back(pos);
+    size_t before = buf.size();
+    PolyCodec::Encode(p, buf);
+    pos += buf.size() - before;
+    if (buf.size() >= (1 << 22)) {
+      Flush();
+    }
+  }
+
+  // Готовый блок, например из другого снимка или журнала
+  void AddBlock(std::string_view block) {
+    Align();
+    offsets.push_back(pos);
+    Put(block.data(), block.size());
+    if (buf.size() >= (1 << 22)) {
+      Flush();
+    }
+  }
+
+  // Дописывает индекс и настоящий заголовок; до вызова файл базой не считается
+  void Finish() {
+    Align();
+    offsets.push_back(pos);
+    DbHeader header = {};
+    std::memcpy(header.magic, DbMagic, sizeof(DbMagic));
+    header.version = DbVersion;
+    header.cf_size = sizeof(long double);
+    header.cf_digits = LDBL_MANT_DIG;
+    header.lanes = LenAlphabet;
+    header.count = offsets.size() - 1;
+    header.index = pos;
+    header.journal = journal;
+    Put(offsets.data(), offsets.size() * sizeof(uint64_t));
+    Flush();
+    out.seekp(0);
+    out.write((const char *) &header, sizeof(header));
+    out.close();
+    if (!out) {
+      throw std::runtime_error("Can not write " + path);
+    }
+  }
+};
+
+// Ленивый доступ к двоичной базе: файл отображается в память,
+// а многочлен собирается только при обращении к нему
+class PolyDbView {
+  MappedFile file;
+  const DbHeader *header;
+  const uint64_t *index;
+
+  [[noreturn]] static void Corrupted() {
+    throw std::runtime_error("Corrupted database file");
+  }
+
+ public:
+  explicit PolyDbView(const std::string &path) : file(path) {
+    if (!IsBinaryDb(file.Data(), file.Size())) {
+      Corrupted();
+    }
+    header = (const DbHeader *) file.Data();
+    if (header->version != DbVersion or header->lanes != (uint32_t) LenAlphabet) {
+      throw std::runtime_error("Unsupported database version");
+    }
+    if (header->cf_size != sizeof(long double) or header->cf_digits != LDBL_MANT_DIG) {
+      throw std::runtime_error("Database was written with a different long double format");
+    }
+    if (header->index % 8 != 0 or header->index > file.Size() or
+        (file.Size() - header->index) / sizeof(uint64_t) <= header->count) {
+      Corrupted();
+    }
+    index = (const uint64_t *) (file.Data() + header->index);
   }
-  Normalize();
-}
 
-long double Monomial::GetY(std::vector<long double> variable) const {
-  long double ans = cf;
-  for (int j = 0; j < LenAlphabet; j++) {
-    if (variable[j] != INF) {
-      ans *= (long double) pow(variable[j], deg[j]);
-    }
+  long long GetSize() const {
+    return (long long) header->count;
   }
-  return ans;
-}
 
-std::vector<int> Monomial::Deg() const {
-  return deg;
-}
+  uint64_t JournalId() const {
+    return header->journal;
+  }
 
-bool Polynomial::CheckCntVars() const {
-  int mask = 0;
-  int cnt = 0;
-  for (int i = 0; i < monos.GetSize(); i++) {
-    for (int j = 0; j < monos[i].deg.size(); j++) {
-      if (monos[i].deg[j] != 0) {
-        if (mask & (1 << j) == 0) {
-          mask |= (1 << j);
-          cnt++;
-        }
-      }
-      if (cnt > 1) return 0;
+  // Сырой блок многочлена внутри отображённого файла
+  std::string_view Block(long long ind) const {
+    if (ind < 0 or ind >= GetSize()) {
+      throw std::out_of_range("Polynomial index is out of range");
+    }
+    uint64_t begin = index[ind], end = index[ind + 1];
+    if (begin % 16 != 0 or begin > end or end > header->index) {
+      Corrupted();
     }
+    return std::string_view(file.Data() + begin, end - begin);
   }
-  return (cnt < 2);
-}
 
-void Polynomial::Normalize() {
-  std::map<Monomial, long double, Comp> temp;
-  for (int i = 0; i < monos.GetSize(); i++) {
-    temp[monos[i]] += monos[i].cf;
-  }
-  Polynomial temp2;
-  for (auto j: temp) {
-    if (std::abs(j.second) > EPS) {
-      temp2.monos.PushBack(Monomial(j.second, j.first.deg));
-    }
+  Polynomial Get(long long ind) const {
+    std::string_view block = Block(ind);
+    return PolyCodec::Decode(block.data(), block.size());
   }
-  *this = temp2;
-  this->monos = MergeSort(this->monos);
-}
+};
+
+struct LoadError {
+  long long line;
+  std::string message;
+};
 
-long double Polynomial::GetY(std::vector<long double> variables) const {
-  std::vector<bool> used(LenAlphabet);
-  for (int j = 0; j < monos.GetSize(); j++) {
-    for (int z = 0; z < LenAlphabet; z++) {
-      if (monos[j].deg[z] != 0) {
-        used[z] = true;
+std::vector<Polynomial> LoadBinaryPolynomials(const std::string &path, std::vector<LoadError> &errors) {
+  PolyDbView view(path);
+  std::vector<Polynomial> res(view.GetSize());
+  std::vector<LoadError> failed;
+  std::mutex mutex;
+  DefaultPool().ParallelFor(view.GetSize(), 256, [&](long long begin, long long end) {
+    for (long long i = begin; i < end; i++) {
+      try {
+        res[i] = view.Get(i);
+      } catch (const std::exception &e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed.push_back(LoadError{i + 1, e.what()});
       }
     }
+  });
+  if (failed.empty()) {
+    return res;
   }
-  long double res = 0;
-  for (int j = 0; j < monos.GetSize(); j++) {
-    res += monos[j].GetY(variables);
+  std::sort(failed.begin(), failed.end(), [](const LoadError &a, const LoadError &b) {
+    return a.line < b.line;
+  });
+  std::vector<Polynomial> good;
+  good.reserve(res.size() - failed.size());
+  size_t next = 0;
+  for (long long i = 0; i < (long long) res.size(); i++) {
+    if (next < failed.size() and failed[next].line == i + 1) {
+      next++;
+    } else {
+      good.push_back(std::move(res[i]));
+    }
   }
-  return res;
+  std::move(failed.begin(), failed.end(), std::back_inserter(errors));
+  return good;
 }
 
-bool Polynomial::operator ==(Polynomial other) {
-  Normalize();
-  other.Normalize();
-  if (monos.GetSize() != other.monos.GetSize()) {
-    return false;
+// Загрузка базы многочленов: файл отображается в память, режется на куски по границам строк,
+// куски разбираются потоками пула в свои буферы и склеиваются в порядке файла.
+// Строки с ошибками не теряются молча, а попадают в errors с номером строки (с единицы).
+// Двоичная база узнаётся по сигнатуре; для неё в errors попадают номера испорченных записей.
+std::vector<Polynomial> LoadPolynomials(const std::string &path, std::vector<LoadError> &errors) {
+  MappedFile file(path);
+  const char *data = file.Data();
+  size_t size = file.Size();
+  if (IsBinaryDb(data, size)) {
+    return LoadBinaryPolynomials(path, errors);
   }
-  for (int i = 0; i < monos.GetSize(); i++) {
-    if (monos[i].deg != other.monos[i].deg or
-        std::abs(monos[i].cf - other.monos[i].cf) > EPS) {
-      return false;
+
+  const size_t min_chunk = 1 << 18;
+  size_t parts = std::max<size_t>(1, std::min<size_t>(size / min_chunk, (size_t) DefaultPool().GetSize() * 4));
+  std::vector<size_t> bounds(1, 0);
+  for (size_t i = 1; i < parts; i++) {
+    size_t pos = std::max(bounds.back(), size * i / parts);
+    const void *nl = pos < size ? std::memchr(data + pos, '\n', size - pos) : nullptr;
+    if (nl == nullptr) {
+      break;
     }
+    bounds.push_back((const char *) nl - data + 1);
   }
-  return true;
-}
+  bounds.push_back(size);
 
-Polynomial Polynomial::operator +(Polynomial other) const {
-  std::map<Monomial, long double, Comp> cur;
-  for (int i = 0; i < monos.GetSize(); i++) {
-    cur[monos[i]] += monos[i].cf;
-  }
-  for (int i = 0; i < other.monos.GetSize(); i++) {
-    cur[other.monos[i]] += other.monos[i].cf;
+  struct Chunk {
+    std::vector<Polynomial> polys;
+    std::vector<LoadError> errors;
+    long long lines = 0;
+  };
+  std::vector<Chunk> chunks(bounds.size() - 1);
+  DefaultPool().ParallelFor((long long) chunks.size(), 1, [&](long long begin, long long end) {
+    for (long long c = begin; c < end; c++) {
+      Chunk &chunk = chunks[c];
+      size_t pos = bounds[c];
+      while (pos < bounds[c + 1]) {
+        const void *nl = std::memchr(data + pos, '\n', bounds[c + 1] - pos);
+        size_t stop = nl ? (const char *) nl - data : bounds[c + 1];
+        std::string_view line(data + pos, stop - pos);
+        if (!line.empty() and line.back() == '\r') {
+          line.remove_suffix(1);
+        }
+        pos = stop + 1;
+        chunk.lines++;
+        if (line.find_first_not_of(' ') == std::string_view::npos) {
+          continue;
+        }
+        try {
+          chunk.polys.push_back(Polynomial(line));
+        } catch (const std::string &e) {
+          chunk.errors.push_back(LoadError{chunk.lines, e});
+        } catch (const std::exception &e) {
+          chunk.errors.push_back(LoadError{chunk.lines, e.what()});
+        }
+      }
+    }
+  });
+
+  std::vector<Polynomial> res;
+  size_t total = 0;
+  for (auto &chunk: chunks) {
+    total += chunk.polys.size();
   }
-  Polynomial res;
-  for (auto i: cur) {
-    if (std::abs(i.second) > EPS) {
-      res.monos.PushBack(Monomial(i.second, i.first.deg));
+  res.reserve(total);
+  long long line_offset = 0;
+  for (auto &chunk: chunks) {
+    std::move(chunk.polys.begin(), chunk.polys.end(), std::back_inserter(res));
+    for (auto &err: chunk.errors) {
+      errors.push_back(LoadError{line_offset + err.line, std::move(err.message)});
     }
+    line_offset += chunk.lines;
   }
-  res.Normalize();
   return res;
 }
 
-Polynomial Polynomial::operator -(Polynomial other) const {
-  std::map<Monomial, long double, Comp> cur;
-  for (int i = 0; i < monos.GetSize(); i++) {
-    cur[monos[i]] += monos[i].cf;
-  }
-  for (int i = 0; i < other.monos.GetSize(); i++) {
-    cur[other.monos[i]] -= other.monos[i].cf;
-  }
-  Polynomial ans;
-  for (auto i: cur) {
-    if (std::abs(i.second) > EPS) {
-      ans.monos.PushBack(Monomial(i.second, i.first.deg));
-    }
+// Журнал изменений базы: записи только дописываются в конец файла.
+// Файл начинается с сигнатуры и номера журнала; запись — длина и контрольная сумма (FNV-1a) тела,
+// затем тело: код операции и данные (блок многочлена или номер удаляемого).
+// Записи копятся в памяти и уходят на диск одним fsync в Commit.
+class Journal {
+ public:
+  enum Op : uint8_t {
+    OpAdd = 1,
+    OpDelete = 2
+  };
+
+ private:
+  std::FILE *file = nullptr;
+  std::string path;
+  std::vector<char> pending;
+  uint64_t id;
+  uint64_t size;
+
+  void Record(Op op, const std::vector<char> &data) {
+    uint32_t len = (uint32_t) data.size() + 1;
+    uint32_t sum = Checksum(op, data.data(), data.size());
+    const char *head = (const char *) &len;
+    pending.insert(pending.end(), head, head + sizeof(len));
+    head = (const char *) &sum;
+    pending.insert(pending.end(), head, head + sizeof(sum));
+    pending.push_back((char) op);
+    pending.insert(pending.end(), data.begin(), data.end());
   }
-  ans.Normalize();
-  return ans;
-}
 
-Polynomial Polynomial::operator *(Polynomial other) const {
-  std::map<Monomial, long double, Comp> tmp;
+ public:
+  static constexpr char Magic[8] = {'P', 'O', 'L', 'Y', 'J', 'R', 'N', '\n'};
+  static constexpr size_t HeaderSize = 16;
 
-  for (int i = 0; i < monos.GetSize(); i++) {
-    for (int j = 0; j < other.monos.GetSize(); j++) {
-      long double cur = other.monos[j].cf * monos[i].cf;
-      std::vector<int> now_step = monos[i].deg;
-      for (int k = 0; k < LenAlphabet; k++) {
-        now_step[k] += other.monos[j].deg[k];
-      }
-      tmp[Monomial(cur, now_step)] += cur;
+  static uint32_t Checksum(uint8_t op, const char *data, size_t size) {
+    uint32_t h = (2166136261u ^ op) * 16777619u;
+    for (size_t i = 0; i < size; i++) {
+      h = (h ^ (uint8_t) data[i]) * 16777619u;
     }
+    return h;
   }
-  Polynomial res;
 
-  for (auto j: tmp) {
-    if (j.second != 0) {
-      res.monos.PushBack(Monomial(j.second, j.first.deg));
+  // Открывает журнал на дописывание; если файла нет, создаёт его с номером id
+  Journal(const std::string &path, uint64_t id) : path(path), id(id) {
+    file = std::fopen(path.c_str(), "ab");
+    if (file == nullptr) {
+      throw std::runtime_error("Can not open " + path);
+    }
+    std::fseek(file, 0, SEEK_END);
+    size = (uint64_t) std::ftell(file);
+    if (size == 0) {
+      pending.insert(pending.end(), Magic, Magic + sizeof(Magic));
+      const char *raw = (const char *) &id;
+      pending.insert(pending.end(), raw, raw + sizeof(id));
+      Commit();
     }
   }
-  return res;
-}
 
-std::pair<Polynomial, Polynomial> Polynomial::operator /(Polynomial other) {
-  Normalize();
-  other.Normalize();
-  int ind = -1;
-  for (int i = 0; i < other.monos.back().deg.size(); i++) {
-    if (other.monos.back().deg[i])ind = i;
+  Journal(const Journal &) = delete;
+
+  Journal &operator =(const Journal &) = delete;
+
+  ~Journal() {
+    try {
+      Commit();
+    } catch (const std::exception &) {
+    }
+    std::fclose(file);
   }
-  Polynomial cur = *this;
-  Polynomial res;
-  std::vector<int> deg(LenAlphabet);
-  while (cur.monos.GetSize() > 0 and cur.monos.back().deg[ind] >= other.monos.back().deg[ind]) {
-    deg[ind] = cur.monos.back().deg[ind] - other.monos.back().deg[ind];
-    long double coef = cur.monos.back().cf / other.monos.back().cf;
-    res.monos.PushBack(Monomial(coef, deg));
-    Polynomial buf;
-    buf.monos.PushBack(Monomial(coef, deg));
-    cur = cur - (buf * other);
-    cur.Normalize();
+
+  void Add(const Polynomial &p) {
+    std::vector<char> data;
+    PolyCodec::Encode(p, data);
+    Record(OpAdd, data);
   }
-  res.Normalize();
-  return make_pair_custom(res, cur);
-}
 
-std::pair<bool, std::vector<int> > Polynomial::FindIntegerRoots() const {
-  if (!CheckCntVars()) {
-    std::vector<int> temp;
-    temp.push_back(1);
-    return make_pair_custom(false, temp);
+  void Delete(long long ind) {
+    std::vector<char> data((const char *) &ind, (const char *) &ind + sizeof(ind));
+    Record(OpDelete, data);
   }
-  int ind_var = -1;
-  int ind_const = -1;
-  bool good = true;
 
-  for (int i = 0; i < monos.GetSize(); i++) {
-    int cnt = 0;
-    for (int j = 0; j < monos[i].deg.size(); j++) {
-      if (monos[i].deg[j] != 0) {
-        ind_var = j;
-        cnt += monos[i].deg[j];
-      }
+  void Commit() {
+    if (pending.empty()) {
+      return;
     }
-    if (cnt == 0) {
-      ind_const = i;
+    if (std::fwrite(pending.data(), 1, pending.size(), file) != pending.size() or std::fflush(file) != 0) {
+      throw std::runtime_error("Can not write " + path);
     }
-    if ((long double) ((int) (monos[i].cf)) != monos[i].cf) {
-      good = false;
-      break;
+#if defined(__unix__) || defined(__APPLE__)
+    if (fsync(fileno(file)) != 0) {
+      throw std::runtime_error("Can not sync " + path);
     }
+#endif
+    size += pending.size();
+    pending.clear();
   }
 
-  if (ind_var == -1) {
-    std::vector<int> temp;
-    temp.push_back(0);
-    return make_pair_custom(false, temp);
+  uint64_t Id() const {
+    return id;
   }
-  if (!good) {
-    std::vector<int> temp;
-    temp.push_back(2);
-    return make_pair_custom(false, temp);
+
+  // Байты на диске вместе с ещё не сброшенными
+  uint64_t Size() const {
+    return size + pending.size();
   }
-  int val = 0;
-  if (ind_const != -1) {
-    val = (int) monos[ind_const].cf;
-    val = abs(val);
+
+  // Номер журнала в отображённом файле; 0, если это не журнал
+  static uint64_t ReadId(const MappedFile &file) {
+    uint64_t res = 0;
+    if (file.Size() >= HeaderSize and std::memcmp(file.Data(), Magic, sizeof(Magic)) == 0) {
+      std::memcpy(&res, file.Data() + sizeof(Magic), sizeof(res));
+    }
+    return res;
   }
-  std::vector<int> res;
-  std::vector<long double> get(LenAlphabet, INF);
-  int cnt = monos[ind_const].cf;
-  for (int j = 1; j * j <= std::abs(cnt); j++) {
-    if (std::abs(cnt) % j == 0) {
-      get[ind_var] = j;
-      auto tmp = GetY(get);
-      if (std::abs(tmp) <= EPS) {
-        res.emplace_back(get[ind_var]);
-      }
-      get[ind_var] = -j;
-      tmp = GetY(get);
-      if (std::abs(tmp) <= EPS) {
-        res.emplace_back(get[ind_var]);
-      }
-      get[ind_var] = std::abs(cnt) / j;
-      tmp = GetY(get);
-      if (std::abs(tmp) <= EPS) {
-        res.emplace_back(get[ind_var]);
+
+  // Передаёт apply записи по порядку и возвращает длину целой части файла:
+  // запись, оборванная при сбое или с неверной суммой, и всё после неё отбрасываются
+  static uint64_t Scan(const MappedFile &file, const std::function<void(Op, std::string_view)> &apply) {
+    const char *data = file.Data();
+    uint64_t pos = HeaderSize;
+    while (file.Size() - pos >= 9) {
+      uint32_t len, sum;
+      std::memcpy(&len, data + pos, sizeof(len));
+      std::memcpy(&sum, data + pos + 4, sizeof(sum));
+      if (len == 0 or len > file.Size() - pos - 8) {
+        break;
       }
-      get[ind_var] = -std::abs(cnt) / j;
-      tmp = GetY(get);
-      if (std::abs(tmp) <= EPS) {
-        res.emplace_back(get[ind_var]);
+      uint8_t op = (uint8_t) data[pos + 8];
+      if (Checksum(op, data + pos + 9, len - 1) != sum) {
+        break;
       }
+      apply((Op) op, std::string_view(data + pos + 9, len - 1));
+      pos += 8 + len;
+    }
+    return pos;
+  }
+};
+
+// База из снимка в двоичном формате (path) и журнала изменений поверх него (path.journal).
+// Сохранение стоит O(изменений): дописывается только журнал. Compact переименовывает журнал
+// в path.journal.old, заводит новый и в фоне сворачивает старый в новый снимок, копируя блоки
+// без разбора. Снимок помнит номер свёрнутого журнала, поэтому сбой на любом шаге
+// не приводит ни к потере, ни к повторному применению записей.
+class JournaledDb {
+  std::string path;
+  std::unique_ptr<Journal> journal;
+  std::future<void> compaction;
+
+  static void Fold(const std::string &path, uint64_t id);
+
+  void StartFold();
+
+ public:
+  // Загружает снимок и журналы в db (db очищается)
+  JournaledDb(const std::string &path, std::vector<Polynomial> &db);
+
+  ~JournaledDb() {
+    if (compaction.valid()) {
+      compaction.wait();
     }
   }
-  get[ind_var] = 0;
-  auto tmp = GetY(get);
-  if (std::abs(tmp) <= EPS) {
-    res.emplace_back(get[ind_var]);
+
+  void Add(const Polynomial &p) {
+    journal->Add(p);
   }
-  std::sort(res.begin(), res.end());
-  std::unique(res.begin(), res.end());
 
-  return make_pair_custom(true, res);
-}
+  void Delete(long long ind) {
+    journal->Delete(ind);
+  }
 
-std::string Polynomial::GetString() const {
-  std::string res;
-  for (int i = 0; i < monos.GetSize(); i++) {
-    if (i == 0) {
-      if (monos[i].cf < 0) {
-        res += "- ";
-      }
+  void Commit() {
+    journal->Commit();
+  }
+
+  uint64_t JournalSize() const {
+    return journal->Size();
+  }
+
+  bool Compacting() const {
+    return compaction.valid() and compaction.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+  }
+
+  // Запускает фоновое сворачивание журнала; false, если прошлое ещё идёт.
+  // Ошибка прошлого сворачивания выбрасывается здесь.
+  bool Compact();
+};
+
+void JournaledDb::Fold(const std::string &path, uint64_t id) {
+  std::string old = path + ".journal.old";
+  std::string tmp = path + ".tmp";
+  std::vector<std::string_view> blocks;
+  std::unique_ptr<PolyDbView> snapshot;
+  if (std::filesystem::exists(path)) {
+    snapshot = std::make_unique<PolyDbView>(path);
+    blocks.reserve(snapshot->GetSize());
+    for (long long i = 0; i < snapshot->GetSize(); i++) {
+      blocks.push_back(snapshot->Block(i));
+    }
+  }
+  MappedFile records(old);
+  Journal::Scan(records, [&](Journal::Op op, std::string_view data) {
+    if (op == Journal::OpAdd) {
+      blocks.push_back(data);
     } else {
-      if (monos[i].cf < 0) {
-        res += "- ";
-      } else {
-        res += "+ ";
+      long long ind = -1;
+      std::memcpy(&ind, data.data(), std::min(data.size(), sizeof(ind)));
+      // удаление несуществующего номера в базе ничего не делало — и здесь тоже
+      if (data.size() == sizeof(ind) and ind >= 0 and ind < (long long) blocks.size()) {
+        blocks.erase(blocks.begin() + ind);
       }
     }
-    bool have_varibles = false;
+  });
+  PolyDbWriter writer(tmp, id);
+  for (auto block: blocks) {
+    writer.AddBlock(block);
+  }
+  writer.Finish();
+  SyncFile(tmp);
+  std::filesystem::rename(tmp, path);
+  std::filesystem::remove(old);
+}
 
-    for (int j = 0; j < monos[i].deg.size(); j++) {
-      if (monos[i].deg[j] != 0) {
-        have_varibles = true;
-      }
+JournaledDb::JournaledDb(const std::string &path, std::vector<Polynomial> &db) : path(path) {
+  db.clear();
+  uint64_t folded = 0;
+  if (std::filesystem::exists(path)) {
+    std::vector<LoadError> errors;
+    db = LoadBinaryPolynomials(path, errors);
+    if (!errors.empty()) {
+      throw std::runtime_error("Corrupted database file " + path);
     }
-
-    if ((monos[i].cf != 1 and monos[i].cf != -1) or !have_varibles) {
-      std::string tmp;
-      if (monos[i].cf > 0) {
-        tmp = std::to_string(monos[i].cf);
+    folded = PolyDbView(path).JournalId();
+  }
+  std::string cur = path + ".journal";
+  std::string old = cur + ".old";
+  uint64_t last = folded;
+  for (const std::string &name: {old, cur}) {
+    if (!std::filesystem::exists(name)) {
+      continue;
+    }
+    uint64_t id, valid, total;
+    {
+      MappedFile file(name);
+      id = Journal::ReadId(file);
+      total = file.Size();
+      if (id <= folded) {
+        // уже в снимке (или пустой файл, не успевший получить заголовок)
+        valid = 0;
       } else {
-        tmp = std::to_string(-monos[i].cf);
-      }
-
-      while (tmp.size() > 0) {
-        if (tmp.back() == '0') {
-          tmp.pop_back();
-        } else if (tmp.back() == '.') {
-          tmp.pop_back();
-          break;
-        } else {
-          break;
-        }
+        valid = Journal::Scan(file, [&](Journal::Op op, std::string_view data) {
+          if (op == Journal::OpAdd) {
+            db.push_back(PolyCodec::Decode(data.data(), data.size()));
+          } else {
+            long long ind = -1;
+            std::memcpy(&ind, data.data(), std::min(data.size(), sizeof(ind)));
+            if (data.size() == sizeof(ind) and ind >= 0 and ind < (long long) db.size()) {
+              db.erase(db.begin() + ind);
+            }
+          }
+        });
+        last = id;
       }
-      res += tmp;
     }
-    for (int j = 0; j < LenAlphabet; j++) {
-      if (monos[i].deg[j] != 0) {
-        res += (j + 'a');
-        if (monos[i].deg[j] != 1) {
-          res += '^';
-          res += std::to_string(monos[i].deg[j]);
-        }
-      }
+    if (valid == 0) {
+      std::filesystem::remove(name);
+    } else if (valid < total) {
+      std::filesystem::resize_file(name, valid);
     }
-    res += ' ';
   }
-  return res;
+  journal = std::make_unique<Journal>(cur, std::filesystem::exists(cur) ? last : last + 1);
+  if (std::filesystem::exists(old)) {
+    // прошлый запуск не успел свернуть старый журнал
+    StartFold();
+  }
 }
 
-int Polynomial::GetMask() const {
-  int mask = 0;
-  for (int i = 0; i < monos.GetSize(); i++) {
-    for (int j = 0; j < monos[i].deg.size(); j++) {
-      if (monos[i].deg[j] != 0) {
-        mask |= (1 << j);
-      }
-    }
+void JournaledDb::StartFold() {
+  uint64_t id;
+  {
+    MappedFile file(path + ".journal.old");
+    id = Journal::ReadId(file);
   }
-  return mask;
+  std::string where = path;
+  compaction = DefaultPool().Submit([where, id] { Fold(where, id); });
 }
 
-bool Polynomial::IsEmpty() const {
-  return monos.GetSize() == 0;
+bool JournaledDb::Compact() {
+  if (Compacting()) {
+    return false;
+  }
+  if (compaction.valid()) {
+    // старый журнал после неудачи остаётся на месте и сворачивается при следующем вызове
+    compaction.get();
+  }
+  std::string cur = path + ".journal";
+  if (!std::filesystem::exists(cur + ".old")) {
+    journal->Commit();
+    uint64_t id = journal->Id();
+    journal.reset();
+    std::filesystem::rename(cur, cur + ".old");
+    journal = std::make_unique<Journal>(cur, id + 1);
+  }
+  StartFold();
+  return true;
 }
 
-Polynomial Polynomial::derivative(int ind) {
-  Polynomial res;
-  for (int i = 0; i < monos.GetSize(); i++) {
-    if (monos[i].deg[ind] != 0) {
-      Monomial cnt(monos[i].cf * monos[i].deg[ind], monos[i].deg);
-      cnt.deg[ind]--;
-      res.monos.PushBack(cnt);
+// Хранилище многочленов с доступом по позиции за O(1).
+// Многочлены лежат в ячейках; порядок добавления задаётся массивом номеров ячеек, поэтому удаление
+// сдвигает только его (четыре байта на элемент), а сами многочлены не копируются.
+// Описатель — номер ячейки и её поколение: он переживает удаление других элементов, а после удаления
+// своего перестаёт находиться, даже если ячейку уже заняли снова (свободные ячейки переиспользуются).
+class PolyStore {
+ public:
+  struct Handle {
+    uint32_t slot;
+    uint32_t gen;
+
+    bool operator ==(const Handle &other) const {
+      return slot == other.slot and gen == other.gen;
     }
+  };
+
+ private:
+  struct Slot {
+    Polynomial poly;
+    uint32_t gen = 0;
+    bool alive = false;
+  };
+
+  std::vector<Slot> slots;
+  std::vector<uint32_t> free;
+  std::vector<uint32_t> order;
+
+ public:
+  int GetSize() const {
+    return (int) order.size();
   }
-  res.Normalize();
-  return res;
-}
 
-std::vector<std::map<char, int> > dfa(8);
-//0 - Начальное состояние
-//1 - После переменной
-//2 - После знака ^ (ожидание степени)
-//3 - В числе степени
-//4 - В целой части коэффициента
-//5 - После точки
-//6 - В дробной части коэффициента
-//7 - После знака +/-
-void BuildDfa() {
-  for (char c = 'a'; c <= 'z'; c++) {
-    dfa[7][c] = 1;
-    dfa[1][c] = 1;
-    dfa[3][c] = 1;
-    dfa[4][c] = 1;
-    dfa[6][c] = 1;
-    dfa[0][c] = 1;
-  }
-  for (char c = '0'; c <= '9'; c++) {
-    dfa[7][c] = 4;
-    dfa[2][c] = 3;
-    dfa[3][c] = 3;
-    dfa[4][c] = 4;
-    dfa[5][c] = 6;
-    dfa[6][c] = 6;
-    dfa[0][c] = 4;
-  }
-  dfa[0]['-'] = 7;
-  dfa[0]['+'] = 7;
-  dfa[1]['^'] = 2;
-  dfa[1]['-'] = 7;
-  dfa[1]['+'] = 7;
-  dfa[3]['+'] = 7;
-  dfa[3]['-'] = 7;
-  dfa[4]['.'] = 5;
-  dfa[4]['+'] = 7;
-  dfa[4]['-'] = 7;
-  dfa[6]['+'] = 7;
-  dfa[6]['-'] = 7;
-}
-void DeleteLastSpace(std::string &cur) {
-  while (cur.size() and cur.back() == ' ') cur.pop_back();
-}
-void CheckString(int v, int ind, std::string &s) {
-  DeletrSpace(s);
-  if (ind == s.size()) {
-    std::string res = "In position " + std::to_string(ind + 1) + ", ";
-    if (v == 5) {
-      res += "There are no numbers after the dot";
-    } else if (v == 2) {
-      res += "There are no numbers after the degree";
-    } else if (v == 0 or v == 7) {
-      res += "There is nothing after the sign";
+  Handle Add(Polynomial p) {
+    uint32_t slot;
+    if (!free.empty()) {
+      slot = free.back();
+      free.pop_back();
+    } else {
+      slot = (uint32_t) slots.size();
+      slots.emplace_back();
     }
-    if (v == 0 or v == 2 or v == 5 or v == 7) {
-      throw res;
+    slots[slot].poly = std::move(p);
+    slots[slot].alive = true;
+    order.push_back(slot);
+    return Handle{slot, slots[slot].gen};
+  }
+
+  // Позиции вне списка игнорируются, как в List::Erase
+  void Erase(int pos) {
+    if (pos < 0 or pos >= GetSize()) {
+      return;
     }
-    return;
+    uint32_t slot = order[pos];
+    order.erase(order.begin() + pos);
+    slots[slot].poly = Polynomial();
+    slots[slot].alive = false;
+    slots[slot].gen++;
+    free.push_back(slot);
   }
-  if (s[ind] == ' ') {
-    while (ind < s.size() and s[ind] == ' ') {
-      ind++;
+
+  void Clear() {
+    while (!order.empty()) {
+      Erase(GetSize() - 1);
     }
-    if (ind == s.size()) {
-      return;
-    } else {
-      if (s[ind] >= '0' and s[ind] <= '9' and (v == 3 or v == 4 or v == 6)) {
-        std::string res = "In position " + std::to_string(ind + 1) + ", you forgot a sign";
-        throw res;
-      }
+  }
+
+  Polynomial &operator [](int pos) {
+    return slots[order[pos]].poly;
+  }
+
+  const Polynomial &operator [](int pos) const {
+    return slots[order[pos]].poly;
+  }
+
+  Handle HandleAt(int pos) const {
+    return Handle{order[pos], slots[order[pos]].gen};
+  }
+
+  // nullptr, если элемент уже удалён
+  Polynomial *Find(Handle h) {
+    if (h.slot >= slots.size() or !slots[h.slot].alive or slots[h.slot].gen != h.gen) {
+      return nullptr;
     }
+    return &slots[h.slot].poly;
   }
-  if (dfa[v].find(s[ind]) == dfa[v].end()) {
-    std::string res = "Error in position " + std::to_string(ind + 1) + ", you can not use " + s[ind] + " after " + s
-    [ind - 1];
-    throw res;
+
+  // Наибольший номер ячейки плюс один — размер для массивов, индексируемых ячейками
+  int SlotCount() const {
+    return (int) slots.size();
   }
-  return CheckString(dfa[v][s[ind]], ind + 1, s);
-}
+};
+
+// Без POLY_NO_GUI дальше идёт фронтенд на SFML + ImGui; проверки из tests/ собираются без него
+#ifndef POLY_NO_GUI
 
 #include <SFML/Graphics.hpp>
 #include <imgui.h>
@@ -831,9 +6401,8 @@ void CheckString(int v, int ind, std::string &s) {
 
 
 
-// Use your Polynomial and List classes defined above
 // Глобальный список полиномов
-List<Polynomial> current;
+PolyStore current;
 
 extern const int LenAlphabet;
 extern const long double INF;
@@ -849,19 +6418,67 @@ void runFrontend() {
   // UI state
   static char inputBuf[256] = "";
   static char filePath[256] = "polynomials.txt";
+  // номера многочленов через пробел: делители и образующие идеала
+  static char divisorsBuf[256] = "1";
+  static char generatorsBuf[256] = "";
   static int selIdxA = 0, selIdxB = 0;
   static int derivVar = 0, derivOrder = 1;
+  static double rootPrecision = 1e-9;
   static std::string resultString;
   static std::string errorMsg;
   static float evalValues[100] = {0.0f}; // Заменить 100 на LenAlphabet при необходимости
 
   // Для сохранения результатов между кадрами
   static Polynomial lastRes;
-  static Polynomial lastQ, lastR;
+  static std::vector<Polynomial> lastQ;
+  static Polynomial lastR;
   static bool hasLastRes = false;
   static bool hasLastQR = false;
 
-  enum Command { None, Add, Sum, Evaluate, IntRoots, Multiply, Divide, Derivative, Compare, Delete } cmd = None;
+  // Открытая через "Open DB" база с журналом: изменения списка дописываются в журнал
+  static std::unique_ptr<JournaledDb> journal;
+  // Подписи строк списка по номерам ячеек хранилища: считаются при первом показе строки,
+  // пустая строка — ещё не посчитана
+  static std::vector<std::string> labels;
+  const size_t previewLen = 200;
+  const size_t resultLen = 4096;
+  auto addPoly = [&](const Polynomial &p) {
+    PolyStore::Handle h = current.Add(p);
+    labels.resize(current.SlotCount());
+    labels[h.slot].clear();
+    if (journal) journal->Add(p);
+  };
+  // false, если номер не число или вне списка
+  auto parseIndices = [&](const char *s, std::vector<int> &out) {
+    out.clear();
+    while (*s) {
+      if (*s == ' ' || *s == ',') { ++s; continue; }
+      char *end;
+      long v = std::strtol(s, &end, 10);
+      if (end == s || v < 0 || v >= current.GetSize()) return false;
+      out.push_back((int) v);
+      s = end;
+    }
+    return !out.empty();
+  };
+  auto erasePoly = [&](int ind) {
+    if (ind < 0 || ind >= current.GetSize()) return;
+    current.Erase(ind);
+    if (journal) journal->Delete(ind);
+  };
+
+  enum Command { None, Add, Sum, Evaluate, IntRoots, AllRoots, Multiply, Divide, Derivative, Compare, Delete, Load, Ordering, Groebner } cmd = None;
+
+  // Тяжёлые команды выполняются в фоне; готовый результат забирается в UI-потоке в начале кадра
+  struct JobResult { std::string text; std::vector<Polynomial> polys; };
+  struct UiJob { std::string name; Command kind; Job<JobResult> job; };
+  static JobExecutor executor(2);
+  static std::vector<UiJob> jobs;
+  auto startJob = [&](const std::string &name, Command kind, std::function<JobResult()> f) {
+    jobs.push_back(UiJob{name, kind, executor.Run(std::move(f))});
+    resultString = name + " is running in background.";
+    hasLastRes = hasLastQR = false;
+  };
 
   while (window.isOpen()) {
     sf::Event event;
@@ -873,55 +6490,165 @@ void runFrontend() {
 
     ImGui::SFML::Update(window, deltaClock.restart());
 
+    for (size_t i = 0; i < jobs.size();) {
+      if (!jobs[i].job.Ready()) { ++i; continue; }
+      UiJob done = std::move(jobs[i]);
+      jobs.erase(jobs.begin() + i);
+      try {
+        JobResult r = done.job.Get();
+        resultString = r.text;
+        if (done.kind == Load || done.kind == Groebner) {
+          for (auto &p : r.polys) addPoly(p);
+        } else if (done.kind == Divide) {
+          // частные по делителям, остаток последним
+          lastR = std::move(r.polys.back());
+          r.polys.pop_back();
+          lastQ = std::move(r.polys);
+          resultString.clear();
+          for (size_t k = 0; k < lastQ.size(); ++k) {
+            resultString += "Q" + (lastQ.size() > 1 ? std::to_string(k + 1) : std::string()) + ":" + lastQ[k].Preview(resultLen) + " ";
+          }
+          resultString += "R:" + lastR.Preview(resultLen);
+          hasLastQR = true;
+          hasLastRes = false;
+        } else if (!r.polys.empty()) {
+          lastRes = std::move(r.polys[0]);
+          resultString = r.text.empty() ? lastRes.Preview(resultLen) : r.text;
+          hasLastRes = true;
+          hasLastQR = false;
+        }
+        // результат показываем в панели своей команды, где есть кнопки сохранения
+        if (done.kind != Load) cmd = done.kind;
+      } catch (const JobCancelled &) {
+        resultString = done.name + " cancelled.";
+      } catch (const std::string &e) {
+        resultString = e;
+      } catch (const std::exception &e) {
+        resultString = e.what();
+      }
+    }
+
     // Левая панель: файл, команды и список
     ImGui::Begin("Commands & List");
     ImGui::InputText("File Path", filePath, sizeof(filePath));
-    if (ImGui::Button("Save DB")) {
-      std::ofstream out(filePath);
-      for (int i = 0; i < current.GetSize(); ++i)
-        out << current[i].GetString() << "\n";
-      resultString = "Database saved.";
+    if (ImGui::Button("Open DB")) {
+      try {
+        journal.reset();
+        std::vector<Polynomial> loaded;
+        journal = std::make_unique<JournaledDb>(filePath, loaded);
+        current.Clear();
+        for (auto &p : loaded) current.Add(std::move(p));
+        labels.assign(current.SlotCount(), std::string());
+        resultString = "Database opened: " + std::to_string(loaded.size()) + " polynomials, changes are journaled.";
+      } catch (const std::exception &e) {
+        journal.reset();
+        resultString = e.what();
+      }
       hasLastRes = hasLastQR = false;
     }
     ImGui::SameLine();
-    if (ImGui::Button("Load DB")) {
-      std::ifstream in(filePath);
-      std::string line;
-      while (std::getline(in, line)) {
-        try { CheckString(0, 0, line); current.PushBack(Polynomial(line)); }
-        catch (...) { /* ignore */ }
+    if (ImGui::Button("Save DB")) {
+      if (journal) {
+        // в журнале уже всё есть; когда он разрастается, сворачиваем его в снимок в фоне
+        try {
+          journal->Commit();
+          bool compact = journal->JournalSize() > (1u << 20);
+          resultString = compact && journal->Compact() ? "Database saved, compacting in background." : "Database saved.";
+        } catch (const std::exception &e) {
+          resultString = e.what();
+        }
+      } else {
+        std::ofstream out(filePath);
+        for (int i = 0; i < current.GetSize(); ++i) {
+          current[i].Write(out);
+          out << '\n';
+        }
+        resultString = "Database saved.";
       }
-      resultString = "Database loaded.";
       hasLastRes = hasLastQR = false;
     }
+    // снимок открытой базы пишется только через журнал
+    if (!journal) {
+      ImGui::SameLine();
+      if (ImGui::Button("Save Binary")) {
+        try {
+          PolyDbWriter writer(filePath);
+          for (int i = 0; i < current.GetSize(); ++i) writer.Add(current[i]);
+          writer.Finish();
+          resultString = "Database saved in binary format.";
+        } catch (const std::exception &e) {
+          resultString = e.what();
+        }
+        hasLastRes = hasLastQR = false;
+      }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load DB")) {
+      startJob("Load DB", Load, [path = std::string(filePath)] {
+        std::vector<LoadError> errors;
+        JobResult r;
+        r.polys = LoadPolynomials(path, errors);
+        r.text = "Database loaded: " + std::to_string(r.polys.size()) + " polynomials, " +
+                 std::to_string(errors.size()) + " errors.";
+        // первые ошибки показываем целиком, остальные только считаем
+        for (size_t i = 0; i < errors.size() && i < 10; ++i)
+          r.text += "\nLine " + std::to_string(errors[i].line) + ": " + errors[i].message;
+        return r;
+      });
+    }
     ImGui::Separator();
     if (ImGui::Button("Add Polynomial"))        { cmd = Add;       errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     if (ImGui::Button("Sum Polynomials"))      { cmd = Sum;       errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     if (ImGui::Button("Evaluate Value"))       { cmd = Evaluate;  errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     if (ImGui::Button("Integer Roots"))        { cmd = IntRoots;  errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
+    if (ImGui::Button("All Roots"))            { cmd = AllRoots;  errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     if (ImGui::Button("Multiply Polynomials")) { cmd = Multiply;  errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     if (ImGui::Button("Divide Polynomials"))   { cmd = Divide;    errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     if (ImGui::Button("Derivative"))           { cmd = Derivative;errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     if (ImGui::Button("Compare"))              { cmd = Compare;   errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
+    if (ImGui::Button("Term Ordering"))        { cmd = Ordering;  errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
+    if (ImGui::Button("Groebner Basis"))       { cmd = Groebner;  errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     if (ImGui::Button("Delete Polynomial"))    { cmd = Delete;    errorMsg.clear(); resultString.clear(); hasLastRes = hasLastQR = false; }
     ImGui::Separator();
-    ImGui::Text("Current Polynomials:");
-    for (int i = 0; i < current.GetSize(); ++i) {
-      std::string temp = current[i].GetString();
-      std::string label = std::to_string(i) + ": " + (!temp.empty()? temp : "0");
-      ImGui::Selectable(label.c_str(), false);
+    ImGui::Text("Current Polynomials: %d", current.GetSize());
+    // рисуются только видимые строки, так что кадр не зависит от размера базы
+    ImGui::BeginChild("List");
+    ImGuiListClipper clipper;
+    clipper.Begin(current.GetSize());
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+        std::string &label = labels[current.HandleAt(i).slot];
+        if (label.empty()) label = current[i].Preview(previewLen);
+        std::string row = std::to_string(i) + ": " + label;
+        ImGui::PushID(i);
+        ImGui::Selectable(row.c_str(), false);
+        ImGui::PopID();
+      }
     }
+    clipper.End();
+    ImGui::EndChild();
     ImGui::End();
 
     // Правая панель: детали команды
     ImGui::Begin("Details");
+    for (size_t i = 0; i < jobs.size(); ++i) {
+      float progress = jobs[i].job.Progress();
+      ImGui::PushID((int) i);
+      ImGui::Text("%s", jobs[i].name.c_str());
+      ImGui::SameLine();
+      if (ImGui::SmallButton("Cancel")) jobs[i].job.Cancel();
+      ImGui::ProgressBar(progress < 0 ? 0.0f : progress, ImVec2(-1, 0), progress < 0 ? "working..." : nullptr);
+      ImGui::PopID();
+    }
+    if (!jobs.empty()) ImGui::Separator();
     switch (cmd) {
       case Add: {
         ImGui::InputText("Polynomial", inputBuf, sizeof(inputBuf), ImGuiInputTextFlags_EnterReturnsTrue);
         if (ImGui::Button("Add")) {
           std::string s(inputBuf);
-          try { CheckString(0,0,s); current.PushBack(Polynomial(s)); resultString = "Added."; inputBuf[0]='\0'; }
+          try { addPoly(Polynomial(s)); resultString = "Added."; inputBuf[0]='\0'; }
           catch (const std::string &e) { errorMsg = e; }
+          catch (const std::overflow_error &e) { errorMsg = e.what(); }
         }
         if (!errorMsg.empty()) ImGui::TextWrapped("%s", errorMsg.c_str());
         if (!resultString.empty()) ImGui::Text("%s", resultString.c_str());
@@ -932,11 +6659,11 @@ void runFrontend() {
         ImGui::SliderInt("Index B", &selIdxB, 0, current.GetSize()-1);
         if (ImGui::Button("Compute Sum")) {
           lastRes = current[selIdxA] + current[selIdxB];
-          resultString = lastRes.GetString();
+          resultString = lastRes.Preview(resultLen);
           hasLastRes = true;
         }
         if (hasLastRes && ImGui::Button("Save Result")) {
-          current.PushBack(lastRes);
+          addPoly(lastRes);
           resultString = "Result saved.";
           hasLastRes = false;
         }
@@ -966,24 +6693,70 @@ void runFrontend() {
       case IntRoots: {
         ImGui::SliderInt("Index", &selIdxA, 0, current.GetSize()-1);
         if (ImGui::Button("Find Roots")) {
-          auto pr = current[selIdxA].FindIntegerRoots();
-          resultString = pr.first ? "Roots:" : "None";
-          for (auto r : pr.second) resultString += " " + std::to_string(r);
-          hasLastRes = false;
+          startJob("Integer Roots", IntRoots, [p = current[selIdxA]] {
+            JobResult res;
+            auto pr = p.FindIntegerRoots();
+            res.text = pr.first ? "Roots:" : "None";
+            for (auto r : pr.second) res.text += " " + std::to_string(r);
+            auto rat = p.FindRationalRoots();
+            if (rat.first) {
+              res.text += "\nRational roots:";
+              for (auto r : rat.second)
+                res.text += " " + std::to_string(r.first) + (r.second != 1 ? "/" + std::to_string(r.second) : "");
+            }
+            return res;
+          });
+        }
+        ImGui::TextWrapped("%s", resultString.c_str());
+        break;
+      }
+      case AllRoots: {
+        ImGui::SliderInt("Index", &selIdxA, 0, current.GetSize()-1);
+        ImGui::InputDouble("Precision", &rootPrecision, 0, 0, "%.1e");
+        if (ImGui::Button("Solve")) {
+          startJob("All Roots", AllRoots, [p = current[selIdxA], precision = rootPrecision] {
+            JobResult res;
+            auto cr = p.FindComplexRoots(precision);
+            if (!cr.first) {
+              res.text = "Only univariate polynomials are supported.";
+              return res;
+            }
+            auto rr = p.IsolateRealRoots(precision);
+            // на больших степенях показываем только начало списка
+            const int shown = 100;
+            char buf[128];
+            res.text = "Real roots (" + std::to_string(rr.second.size()) + "):";
+            for (int i = 0; i < (int) rr.second.size() && i < shown; ++i) {
+              snprintf(buf, sizeof(buf), " [%.12Lg, %.12Lg]", rr.second[i].first, rr.second[i].second);
+              res.text += buf;
+            }
+            res.text += "\nComplex roots (" + std::to_string(cr.second.size()) + "):";
+            for (int i = 0; i < (int) cr.second.size() && i < shown; ++i) {
+              snprintf(buf, sizeof(buf), " %.12Lg%+.12Lgi", cr.second[i].real(), cr.second[i].imag());
+              res.text += buf;
+            }
+            if ((int) cr.second.size() > shown) res.text += " ...";
+            return res;
+          });
         }
         ImGui::TextWrapped("%s", resultString.c_str());
         break;
       }
       case Multiply: {
+        // auto: целые точно в BigInt, остальные в long double
+        static int ringSel = (int) CoefRing::Auto;
         ImGui::SliderInt("Index A", &selIdxA, 0, current.GetSize()-1);
         ImGui::SliderInt("Index B", &selIdxB, 0, current.GetSize()-1);
+        ImGui::Combo("Coefficients", &ringSel, "auto\0long double\0double\0int64 (checked)\0int128 (checked)\0rational\0mod 998244353\0");
         if (ImGui::Button("Multiply")) {
-          lastRes = current[selIdxA] * current[selIdxB];
-          resultString = lastRes.GetString();
-          hasLastRes = true;
+          startJob("Multiply", Multiply, [a = current[selIdxA], b = current[selIdxB], ring = (CoefRing) ringSel, limit = resultLen] {
+            // запись результата — в выбранном кольце; в список сохраняется его перевод в long double
+            auto prod = RingProduct(a, b, ring, limit);
+            return JobResult{prod.first, {std::move(prod.second)}};
+          });
         }
         if (hasLastRes && ImGui::Button("Save Result")) {
-          current.PushBack(lastRes);
+          addPoly(lastRes);
           resultString = "Result saved.";
           hasLastRes = false;
         }
@@ -991,31 +6764,43 @@ void runFrontend() {
         break;
       }
       case Divide: {
+        // старшие члены берутся в порядке делимого (см. Term Ordering)
         ImGui::SliderInt("Dividend", &selIdxA, 0, current.GetSize()-1);
-        ImGui::SliderInt("Divisor", &selIdxB, 0, current.GetSize()-1);
+        ImGui::InputText("Divisors (indices)", divisorsBuf, sizeof(divisorsBuf));
         if (ImGui::Button("Divide")) {
-          int maskA = current[selIdxA].GetMask();
-          int maskB = current[selIdxB].GetMask();
-          std::cout << maskB;
-          if (maskB == 0){
-            resultString = "Division by zero is incorrect.";
+          std::vector<int> ids;
+          bool zero = false;
+          bool ok = parseIndices(divisorsBuf, ids);
+          for (int k : ids) zero = zero || current[k].IsEmpty();
+          if (!ok) {
+            resultString = "Enter divisor indices from 0 to " + std::to_string(current.GetSize() - 1) + ".";
             hasLastQR = false;
-          }
-          else if ((maskA & (maskA-1)) || (maskB & (maskB-1))) {
-            resultString = "Division only for univariate polynomials.";
+          } else if (zero) {
+            resultString = "Division by zero is incorrect.";
             hasLastQR = false;
           } else {
-            auto qr = current[selIdxA] / current[selIdxB];
-            lastQ = qr.first;
-            lastR = qr.second;
-            resultString = "Q:" + (!lastQ.GetString().empty()? lastQ.GetString() : "0")  + " R:" + (!lastR.GetString().empty()? lastQ.GetString() : "0");
-            hasLastQR = true;
+            std::vector<Polynomial> divisors;
+            for (int k : ids) divisors.push_back(current[k]);
+            startJob("Divide", Divide, [a = current[selIdxA], divisors = std::move(divisors)]() mutable {
+              int mask = a.GetMask() | divisors[0].GetMask();
+              JobResult res;
+              if (divisors.size() == 1 && (mask & (mask - 1)) == 0) {
+                // одна переменная: плотное деление
+                auto qr = a / divisors[0];
+                res.polys = {std::move(qr.first), std::move(qr.second)};
+              } else {
+                auto qr = a.Reduce(divisors);
+                res.polys = std::move(qr.first);
+                res.polys.push_back(std::move(qr.second));
+              }
+              return res;
+            });
           }
         }
         if (hasLastQR) {
-          if (ImGui::Button("Save Quotient")) { current.PushBack(lastQ); resultString = "Quotient saved."; hasLastQR = false; }
+          if (ImGui::Button("Save Quotient")) { for (auto &q : lastQ) addPoly(q); resultString = "Quotient saved."; hasLastQR = false; }
           ImGui::SameLine();
-          if (ImGui::Button("Save Remainder")) { current.PushBack(lastR); resultString = "Remainder saved."; hasLastQR = false; }
+          if (ImGui::Button("Save Remainder")) { addPoly(lastR); resultString = "Remainder saved."; hasLastQR = false; }
         }
         ImGui::TextWrapped("%s", resultString.c_str());
         break;
@@ -1025,13 +6810,12 @@ void runFrontend() {
         ImGui::InputInt("Variable (0=a,...)", &derivVar);
         ImGui::InputInt("Order", &derivOrder);
         if (ImGui::Button("Derive")) {
-          lastRes = current[selIdxA];
-          for (int i = 0; i < derivOrder; ++i) lastRes = lastRes.derivative(derivVar);
-          resultString = lastRes.GetString();
-          hasLastRes = true;
+          startJob("Derivative", Derivative, [p = current[selIdxA], var = derivVar, order = derivOrder]() mutable {
+            return JobResult{"", {p.derivative(var, order)}};
+          });
         }
         if (hasLastRes && ImGui::Button("Save Result")) {
-          current.PushBack(lastRes);
+          addPoly(lastRes);
           resultString = "Result saved.";
           hasLastRes = false;
         }
@@ -1048,10 +6832,49 @@ void runFrontend() {
         ImGui::TextWrapped("%s", resultString.c_str());
         break;
       }
+      case Ordering: {
+        // порядок членов влияет на запись и на старший член при делении
+        static int orderSel = 0;
+        ImGui::SliderInt("Index", &selIdxA, 0, current.GetSize()-1);
+        ImGui::RadioButton("lex", &orderSel, (int) MonomialOrder::Lex); ImGui::SameLine();
+        ImGui::RadioButton("grlex", &orderSel, (int) MonomialOrder::GrLex); ImGui::SameLine();
+        ImGui::RadioButton("grevlex", &orderSel, (int) MonomialOrder::GrevLex);
+        if (ImGui::Button("Apply") && selIdxA >= 0 && selIdxA < current.GetSize()) {
+          current[selIdxA].SetOrder((MonomialOrder) orderSel);
+          labels[current.HandleAt(selIdxA).slot].clear();
+          resultString = current[selIdxA].Preview(resultLen);
+        }
+        ImGui::TextWrapped("%s", resultString.c_str());
+        break;
+      }
+      case Groebner: {
+        // приведённый базис идеала выбранных многочленов; готовый базис дописывается в список
+        static int basisOrder = (int) MonomialOrder::GrevLex;
+        ImGui::InputText("Generators (indices)", generatorsBuf, sizeof(generatorsBuf));
+        ImGui::RadioButton("lex", &basisOrder, (int) MonomialOrder::Lex); ImGui::SameLine();
+        ImGui::RadioButton("grlex", &basisOrder, (int) MonomialOrder::GrLex); ImGui::SameLine();
+        ImGui::RadioButton("grevlex", &basisOrder, (int) MonomialOrder::GrevLex);
+        if (ImGui::Button("Compute Basis")) {
+          std::vector<int> ids;
+          if (!parseIndices(generatorsBuf, ids)) {
+            resultString = "Enter generator indices from 0 to " + std::to_string(current.GetSize() - 1) + ".";
+          } else {
+            std::vector<Polynomial> gens;
+            for (int k : ids) gens.push_back(current[k]);
+            startJob("Groebner Basis", Groebner, [gens = std::move(gens), order = (MonomialOrder) basisOrder] {
+              JobResult res{"", GroebnerBasis(gens, order)};
+              res.text = "Groebner basis: " + std::to_string(res.polys.size()) + " polynomials added.";
+              return res;
+            });
+          }
+        }
+        ImGui::TextWrapped("%s", resultString.c_str());
+        break;
+      }
       case Delete: {
         ImGui::SliderInt("Index to delete", &selIdxA, 0, current.GetSize()-1);
         if (ImGui::Button("Delete")) {
-          current.Erase(selIdxA); // реализуйте метод RemoveAt или аналогичный
+          erasePoly(selIdxA);
           resultString = "Deleted.";
           selIdxA = 0; // сброс
         }
@@ -1063,11 +6886,19 @@ void runFrontend() {
     }
     ImGui::End();
 
+    // все изменения за кадр уходят на диск одним fsync
+    if (journal) {
+      try { journal->Commit(); }
+      catch (const std::exception &e) { resultString = e.what(); }
+    }
+
     window.clear(sf::Color(15,15,15));
     ImGui::SFML::Render(window);
     window.display();
   }
 
+  // незаконченные задачи прерываются в ближайшей точке проверки
+  for (auto &j : jobs) j.job.Cancel();
   ImGui::SFML::Shutdown();
 }
 
@@ -1075,7 +6906,8 @@ void runFrontend() {
 
 
 int main(){
-  BuildDfa();
   runFrontend();
   return 0;
 }
+
+#endif
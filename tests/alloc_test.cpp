@@ -0,0 +1,153 @@
+// Регрессионная проверка числа выделений памяти в операторах Polynomial и List.
+// Сборка и запуск: tests/run.sh (или g++ -std=c++17 -O2 -DPOLY_NO_GUI tests/alloc_test.cpp -pthread)
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+
+// Счётчик всех выделений, включая выровненные (через них идут pmr-массивы)
+static long long allocs = 0;
+
+// Все формы new берут память у malloc или aligned_alloc, все формы delete отдают её free.
+// GCC, встраивая delete в место вызова, видит free от результата new и ругается
+// -Wmismatched-new-delete, хотя здесь пара согласована.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(std::size_t n) {
+  allocs++;
+  if (void *p = std::malloc(n ? n : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t n) {
+  return operator new(n);
+}
+
+void *operator new(std::size_t n, std::align_val_t a) {
+  allocs++;
+  size_t align = (size_t) a;
+  if (void *p = std::aligned_alloc(align, (n + align - 1) / align * align)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t n, std::align_val_t a) {
+  return operator new(n, a);
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#pragma GCC diagnostic pop
+
+#include "../main.cpp"
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what, long long got) {
+  std::printf("%s %s (%lld allocations)\n", ok ? "ok  " : "FAIL", what, got);
+  failures += !ok;
+}
+
+int main() {
+  Polynomial a("3x^4y + 2x^3 - xy^2 + 5y - 7");
+  Polynomial b("x^4y - 4x^2y^2 + y^3 + 2");
+  Polynomial c("x^2 + y^2 + 1");
+
+  // сумма константных операндов: только буферы результата (коэффициенты и степени)
+  long long before = allocs;
+  Polynomial sum = a + b;
+  Check(allocs - before <= 2, "a + b", allocs - before);
+
+  // += и -= в буфер с запасом ёмкости ничего не выделяют
+  Polynomial acc = a + b + c;
+  acc -= b;
+  acc -= c;
+  before = allocs;
+  for (int i = 0; i < 100; i++) {
+    acc += b;
+    acc -= b;
+  }
+  Check(allocs - before == 0, "reused += / -= buffer", allocs - before);
+  Check(acc == a, "+= / -= result", 0);
+
+  Polynomial same = a + b - c + c;
+  before = allocs;
+  bool equal = sum == same and !(sum == a);
+  Check(allocs - before == 0 and equal, "==", allocs - before);
+
+  // временный левый операнд отдаёт свой буфер: (a * b) + c не дороже a * b и одного расширения
+  before = allocs;
+  Polynomial prod = a * b;
+  long long mul = allocs - before;
+  before = allocs;
+  Polynomial fused = a * b + c;
+  Check(allocs - before <= mul + 2 and fused == prod + c, "(a * b) + c reuses the product", allocs - before);
+
+  // Карацуба берёт все промежуточные массивы из рабочей памяти: с прогретой ареной
+  // выделяется только результат
+  std::vector<long double> da(500), db(200);
+  for (int i = 0; i < 500; i++) {
+    da[i] = i % 7 - 3;
+  }
+  for (int i = 0; i < 200; i++) {
+    db[i] = i % 5 - 2;
+  }
+  Arena arena;
+  {
+    ScratchScope scope(arena);
+    DenseMultiply(da, db);
+    arena.Reset();
+    before = allocs;
+    std::vector<long double> dense = DenseMultiply(da, db);
+    Check(allocs - before == 1 and dense.size() == 699, "Karatsuba in a warm arena", allocs - before);
+  }
+
+  // Merge и MergeSort перецепляют узлы
+  List<int> list;
+  for (int i = 0; i < 2000; i++) {
+    list.PushBack((i * 7919) % 2000);
+  }
+  before = allocs;
+  List<int> sorted = MergeSort(std::move(list));
+  Check(allocs - before == 0, "MergeSort", allocs - before);
+  bool ordered = sorted.GetSize() == 2000;
+  for (int i = 0; i < sorted.GetSize() and ordered; i++) {
+    ordered = sorted[i] == i;
+  }
+  Check(ordered, "MergeSort result", 0);
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+// Проверки плотных ядер умножения против школьного умножения.
+// Сборка и запуск: tests/run.sh
+#include "../main.cpp"
+
+#include <random>
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  failures += !ok;
+}
+
+// Точная свёртка целых по модулю 2^64: для сравнения младших разрядов
+static std::vector<unsigned long long> ExactConvolution(const std::vector<long double> &a,
+                                                        const std::vector<long double> &b) {
+  std::vector<unsigned long long> res(a.size() + b.size() - 1, 0);
+  for (size_t i = 0; i < a.size(); i++) {
+    unsigned long long x = (unsigned long long) (long long) a[i];
+    for (size_t j = 0; j < b.size(); j++) {
+      res[i + j] += x * (unsigned long long) (long long) b[j];
+    }
+  }
+  return res;
+}
+
+static bool SameAsExact(const std::vector<long double> &a, const std::vector<long double> &b,
+                        const std::vector<long double> &res) {
+  std::vector<unsigned long long> exact = ExactConvolution(a, b);
+  if (res.size() != exact.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < res.size(); i++) {
+    // значения меньше 2^63 представимы в long double точно
+    if ((unsigned long long) (long long) res[i] != exact[i] or res[i] != std::floor(res[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  std::mt19937 rng(7);
+  auto random = [&](int n, long long limit) {
+    std::vector<long double> v(n);
+    for (auto &x: v) {
+      x = (long double) (long long) (rng() % (2 * limit + 1)) - limit;
+    }
+    return v;
+  };
+
+  // граница max|a| * max|b| * n чуть меньше 2^50, а почти равные положительные коэффициенты дают
+  // наибольшие суммы: прежнее правило (bound < 2^50) округляло неточный результат
+  {
+    int n = 32768;
+    std::vector<long double> a(n), b(n);
+    for (int i = 0; i < n; i++) {
+      a[i] = 185362 - (long double) (rng() % 16);
+      b[i] = 185362 - (long double) (rng() % 16);
+    }
+    std::vector<long double> res(2 * n - 1, 0.0L);
+    FftMultiply(a.data(), n, b.data(), n, res.data());
+    Check(SameAsExact(a, b, res), "FftMultiply, 32768 terms, |coef| <= 185362");
+  }
+  // крупные целые: вход режется на части несколько раз
+  {
+    int n = 4096;
+    std::vector<long double> a = random(n, 1LL << 24), b = random(n, 1LL << 24);
+    Check(SameAsExact(a, b, DenseMultiply(a, b)), "DenseMultiply, 4096 terms, |coef| < 2^24");
+  }
+  {
+    std::vector<long double> a = random(3000, 1000), b = random(2000, 1000);
+    Check(SameAsExact(a, b, DenseMultiply(a, b)), "DenseMultiply, small coefficients");
+  }
+  // Карацуба с нечётными длинами на каждом уровне рекурсии
+  {
+    std::vector<long double> a = random(731, 1000), b = random(253, 1000);
+    Check(SameAsExact(a, b, DenseMultiply(a, b)), "DenseMultiply, Karatsuba range");
+  }
+  // разреженное произведение: 0.1 * (-2.1) + 0.7 * 0.3 в long double даёт остаток порядка 1e-20
+  {
+    Polynomial prod = Polynomial("0.1a^100 + 0.7b") * Polynomial("0.3a^100 - 2.1b");
+    Check(prod.GetString().find("a^100b") == std::string::npos, "HeapMultiply drops cancelled terms");
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+// Проверки точной целочисленной арифметики.
+// Сборка и запуск: tests/run.sh
+#include "../main.cpp"
+
+#include <random>
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  failures += !ok;
+}
+
+// Случайное число из words слов по 32 бита со случайным знаком
+static BigInt RandomBig(std::mt19937 &rng, int words) {
+  BigInt res(0LL);
+  for (int i = 0; i < words; i++) {
+    res.MulAdd(1u << 31, rng() >> 1);
+    res.MulAdd(2, rng() & 1);
+  }
+  return rng() & 1 ? -res : res;
+}
+
+int main() {
+  {
+    // при длине 2^22 простых больше 2^29 всего около дюжины, остальные меньше
+    int bits = 29 * 16;
+    std::vector<uint32_t> primes = NttPrimes(22, bits);
+    BigInt modulus(1LL);
+    bool ok = !primes.empty();
+    for (uint32_t p: primes) {
+      ok = ok and IsPrime64(p) and (p - 1) % (1u << 22) == 0;
+      modulus = modulus * BigInt((long long) p);
+    }
+    Check(ok and modulus.BitLength() > bits, "NTT primes for 2^22 cover the requested bits");
+    Check(NttPrimes(22, 100000).empty(), "too many bits give no primes");
+  }
+  {
+    std::mt19937 rng(7);
+    std::vector<BigInt> a(300), b(200);
+    for (auto &x: a) {
+      x = RandomBig(rng, 14);
+    }
+    for (auto &x: b) {
+      x = RandomBig(rng, 14);
+    }
+    std::vector<BigInt> prod = DenseProduct(a, b);
+    std::vector<BigInt> naive(a.size() + b.size() - 1, BigInt(0LL));
+    for (size_t i = 0; i < a.size(); i++) {
+      for (size_t j = 0; j < b.size(); j++) {
+        naive[i + j] += a[i] * b[j];
+      }
+    }
+    bool same = prod.size() == naive.size();
+    for (size_t i = 0; same and i < prod.size(); i++) {
+      same = prod[i] == naive[i];
+    }
+    Check(same, "multi-modular product of 450-bit coefficients");
+  }
+  {
+    // (2^40 + 1)^2 = 2^80 + 2^41 + 1 не представимо в long double, а точная запись сохраняет единицу
+    Polynomial a("1099511627777x + 1");
+    auto prod = RingProduct(a, a, CoefRing::Auto, 4096);
+    Check(prod.first == "1 + 2199023255554x + 1208925819616828197961729x^2 ", "integer inputs are multiplied exactly");
+    Check(RingProduct(a, Polynomial("0.5x"), CoefRing::Auto, 4096).first.empty(),
+          "fractional inputs stay in long double");
+  }
+  {
+    Polynomial a("0.5x + 0.25");
+    Check(RingProduct(a, a, CoefRing::Rational, 4096).first == "(1/16) + (1/4)x + (1/4)x^2 ",
+          "rational product keeps fractions");
+    // 0.5 по модулю 998244353 — обратный к 2
+    Check(RingProduct(Polynomial("2x"), Polynomial("0.5"), CoefRing::Mod998, 4096).first == "x ",
+          "product in Z/998244353");
+    bool overflow = false;
+    try {
+      Polynomial big("3000000000x");
+      RingProduct(big, big * big, CoefRing::Int64, 4096);
+    } catch (const std::overflow_error &) {
+      overflow = true;
+    }
+    Check(overflow, "int64 product reports overflow");
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+// Проверки модульного базиса Грёбнера.
+// Сборка и запуск: tests/run.sh
+#include "../main.cpp"
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  failures += !ok;
+}
+
+static std::vector<Polynomial> Gens(const std::vector<std::string> &s) {
+  std::vector<Polynomial> res;
+  for (auto &x: s) {
+    res.emplace_back(x);
+  }
+  return res;
+}
+
+// Каждый образующий делится на базис нацело
+static bool Generates(const std::vector<Polynomial> &gens, const std::vector<Polynomial> &basis, MonomialOrder order) {
+  for (Polynomial g: gens) {
+    g.SetOrder(order);
+    if (!g.Reduce(basis).second.IsEmpty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  {
+    auto gens = Gens({"a + b + c + d", "ab + bc + cd + da", "abc + bcd + cda + dab", "abcd - 1"});
+    auto basis = GroebnerBasis(gens, MonomialOrder::GrevLex);
+    Check(basis.size() == 7 and Generates(gens, basis, MonomialOrder::GrevLex), "cyclic-4, grevlex");
+  }
+  {
+    // по первому простому 1073741789 образующие совпадают, и базис выходит из одного элемента
+    auto gens = Gens({"x + y", "x + 1073741790y"});
+    auto basis = GroebnerBasis(gens, MonomialOrder::Lex);
+    Check(basis.size() == 2 and basis[0].GetString() == "x " and basis[1].GetString() == "y ",
+          "unlucky first prime is replaced");
+  }
+  {
+    // первое простое делит коэффициент образующего и пропускается
+    auto gens = Gens({"1073741789x - y", "y^2 - 1"});
+    auto basis = GroebnerBasis(gens, MonomialOrder::Lex);
+    Check(basis.size() == 2 and Generates(gens, basis, MonomialOrder::Lex), "prime dividing a coefficient");
+  }
+  {
+    // 11 * (10^25 / 11) != 10^25 в long double: остаток старшего члена не должен делиться ещё раз
+    auto qr = Polynomial("10000000000000000000000000a^2b^2 + 1") / Polynomial("11ab - 1");
+    std::vector<long double> vars(LenAlphabet, INF);
+    vars[0] = vars[1] = 0;
+    Check(qr.first.GetY(vars) == 1e25L / 11 / 11, "multivariate division removes the leading term exactly");
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+// Проверки разбора строк с многочленами.
+// Сборка и запуск: tests/run.sh
+#include "../main.cpp"
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  failures += !ok;
+}
+
+// Значение многочлена от одной переменной a
+static long double ValueAt(const std::string &s, long double a) {
+  std::vector<long double> vars(LenAlphabet, INF);
+  vars[0] = a;
+  return Polynomial(s).GetY(vars);
+}
+
+int main() {
+  // дробь — это целая мантисса, делённая на 10^k одним делением
+  Check(ValueAt("0.1", 0) == 1 / 10.0L, "0.1 is correctly rounded");
+  Check(ValueAt("2.675", 0) == 2675 / 1000.0L, "2.675 is correctly rounded");
+  Check(ValueAt("123456789.123456789", 0) == 123456789123456789 / 1e9L, "18 significant digits");
+  Check(ValueAt("0.5a + 1.25", 2) == 2.25L, "decimal coefficients of a term");
+  {
+    // план GetY строится один раз и сбрасывается после изменения многочлена
+    std::vector<long double> vars(LenAlphabet, INF);
+    vars[0] = 2;
+    Polynomial p("a^2 + 1");
+    Polynomial copy = p;
+    bool first = p.GetY(vars) == 5 and p.GetY(vars) == 5;
+    p += Polynomial("a");
+    Check(first and p.GetY(vars) == 7 and copy.GetY(vars) == 5, "cached evaluation plan follows changes");
+  }
+  bool thrown = false;
+  try {
+    CheckString("1.");
+  } catch (const std::string &) {
+    thrown = true;
+  }
+  Check(thrown, "a dot without digits is rejected");
+  return failures == 0 ? 0 : 1;
+}
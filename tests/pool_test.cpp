@@ -0,0 +1,68 @@
+// Проверки пула потоков.
+// Сборка и запуск: tests/run.sh
+#include "../main.cpp"
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  failures += !ok;
+}
+
+int main() {
+  ThreadPool pool(4);
+  {
+    std::atomic<long long> sum{0};
+    pool.ParallelFor(100000, 1000, [&](long long begin, long long end) {
+      for (long long i = begin; i < end; i++) {
+        sum += i;
+      }
+    });
+    Check(sum.load() == 100000LL * 99999 / 2, "every index is visited once");
+  }
+  {
+    // исключение из куска доходит до вызывающего, а не до std::terminate в рабочем потоке
+    std::string caught;
+    try {
+      pool.ParallelFor(1000, 10, [](long long begin, long long) {
+        if (begin >= 500) {
+          throw std::runtime_error("chunk " + std::to_string(begin));
+        }
+      });
+    } catch (const std::runtime_error &e) {
+      caught = e.what();
+    }
+    Check(caught.rfind("chunk ", 0) == 0, "exception from a chunk is rethrown on the caller");
+  }
+  {
+    std::atomic<long long> cnt{0};
+    pool.ParallelFor(64, 1, [&](long long, long long) {
+      cnt++;
+    });
+    Check(cnt.load() == 64, "pool keeps working after a failed loop");
+  }
+  {
+    // задачи исполнителя берут рабочую память из арены своего потока, вне задач — из кучи
+    JobExecutor executor(1);
+    auto job = executor.Run([] {
+      std::vector<long double> a(300, 1.0L), b(200, 2.0L);
+      long double sum = 0;
+      for (long double x: DenseMultiply(a, b)) {
+        sum += x;
+      }
+      return Scratch() != std::pmr::get_default_resource() and sum == 300 * 200 * 2;
+    });
+    Check(job.Get(), "job runs with an arena scratch scope");
+    Check(Scratch() == std::pmr::get_default_resource(), "caller keeps the default resource");
+  }
+  {
+    // сверх предела арена отдаёт память из кучи и не растёт
+    Arena arena(1 << 16);
+    void *small = arena.allocate(1024, 16);
+    void *big = arena.allocate(1 << 20, 16);
+    Check(small != nullptr and big != nullptr and arena.Capacity() <= (1 << 16), "arena stays within its limit");
+    arena.deallocate(big, 1 << 20, 16);
+    arena.deallocate(small, 1024, 16);
+  }
+  return failures == 0 ? 0 : 1;
+}
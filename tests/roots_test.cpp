@@ -0,0 +1,52 @@
+// Проверки поиска корней одномерных многочленов.
+// Сборка и запуск: tests/run.sh
+#include "../main.cpp"
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+  failures += !ok;
+}
+
+// Коэффициенты произведения (x - r) по всем корням
+static std::vector<long double> FromRoots(const std::vector<long double> &roots) {
+  std::vector<long double> a(1, 1.0L);
+  for (long double r: roots) {
+    std::vector<long double> b(a.size() + 1, 0.0L);
+    for (size_t i = 0; i < a.size(); i++) {
+      b[i + 1] += a[i];
+      b[i] -= r * a[i];
+    }
+    a = b;
+  }
+  return a;
+}
+
+int main() {
+  {
+    // (x - 1)(K x + 1), K = 3 * 2^125: |a_n| + max |a_i| не помещается в __int128
+    __int128 k = (__int128) 3 << 125;
+    std::vector<__int128> a = {-1, 1 - k, k};
+    auto roots = ExactRationalRoots(a, true);
+    Check(roots.size() == 1 and roots[0].first == 1 and roots[0].second == 1,
+          "integer root with coefficients near the __int128 limit");
+  }
+  {
+    // (2x - 3)(x + 5)(x^2 + 1)
+    std::vector<__int128> a = {-15, 7, -13, 7, 2};
+    auto roots = ExactRationalRoots(a, false);
+    Check(roots.size() == 2 and roots[0] == std::make_pair(-5LL, 1LL) and roots[1] == std::make_pair(3LL, 2LL),
+          "rational roots of (2x - 3)(x + 5)(x^2 + 1)");
+  }
+  {
+    // остаток ряда Штурма порядка 1e-11 не должен теряться
+    auto segs = SturmIsolate(FromRoots({1, 1 + 1e-5L}), 1e-9L);
+    Check(segs.size() == 2 and segs[0].second < segs[1].first, "Sturm separates roots 1 and 1 + 1e-5");
+  }
+  {
+    auto segs = SturmIsolate(FromRoots({1, 1, 2, -3, -3}), 1e-9L);
+    Check(segs.size() == 3, "Sturm counts distinct roots of (x - 1)^2 (x - 2) (x + 3)^2");
+  }
+  return failures == 0 ? 0 : 1;
+}
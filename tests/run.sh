@@ -0,0 +1,12 @@
+#!/bin/sh
+# Собирает каждый tests/*_test.cpp без графического фронтенда и запускает его
+set -e
+dir=$(cd "$(dirname "$0")" && pwd)
+out=${TMPDIR:-/tmp}/polynomial-tests
+mkdir -p "$out"
+for src in "$dir"/*_test.cpp; do
+  name=$(basename "$src" .cpp)
+  echo "== $name"
+  ${CXX:-g++} -std=c++17 -O2 -DPOLY_NO_GUI "$src" -o "$out/$name" -pthread
+  "$out/$name"
+done